@@ -81,9 +81,12 @@
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           1
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
+/* Run time is counted in microseconds of the RP2040 timer, which runs from boot */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()        time_us_32()
 
 /* Co-routine related definitions. */
 #define configUSE_CO_ROUTINES                   0
@@ -116,6 +119,7 @@
 #define configSUPPORT_PICO_TIME_INTEROP         1
 
 #include <assert.h>
+#include "hardware/timer.h"
 /* Define to trap errors during development. */
 #define configASSERT(x)                         assert(x)
 
@@ -139,6 +143,11 @@ to exclude the API function. */
 #define INCLUDE_xQueueGetMutexHolder            1
 
 /* A header file that defines trace macro can be included here. */
+/* Task switches go to the event tracer, see trace/trace.h. These expand inside
+   tasks.c, uxTCBNumber is the xTaskNumber uxTaskGetSystemState reports. */
+extern void trace_task_switch(int switched_in, unsigned number);
+#define traceTASK_SWITCHED_IN()                 trace_task_switch(1, pxCurrentTCB->uxTCBNumber)
+#define traceTASK_SWITCHED_OUT()                trace_task_switch(0, pxCurrentTCB->uxTCBNumber)
 
 #endif /* FREERTOS_CONFIG_H */
 
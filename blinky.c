@@ -1,6 +1,5 @@
 #include "FreeRTOS.h"
 #include "pico/stdlib.h"
-#include "pico/mutex.h"
 #include "hardware/pwm.h"
 #include "hardware/gpio.h"
 #include <sys/time.h>
@@ -10,30 +9,29 @@
 #include "motor.h"
 #include "ultrasonic.h"
 #include "magnometer.h"
+#include "events.h"
+#include "command.h"
+#include "teleop.h"
+#include "stream.h"
+#include "telemetry.h"
+#include "logging.h"
+#include "isrstats.h"
+#include "gpioirq.h"
+#include "irqbench.h"
+#include "move.h"
+#include "remote.h"
 
 // Ir Sensor Pins
 #define IR_LEFT_PIN 26
 #define IR_RIGHT_PIN 27
 
-#define DEFAULT_SPEED 62500 * 0.1
-
 #define TRI_PIN 13
 #define ECHO_PIN 12
 
-#define mbaTASK_MESSAGE_BUFFER_SIZE (60)
-
-MessageBufferHandle_t move_mode_buffer;
-MessageBufferHandle_t dist_buffer;
-MessageBufferHandle_t turn_buffer;
-
-static volatile float tkp = 0.1, tki = 0, tkd = 0.05;
-static volatile float fkp = 0.15, fki = 0, fkd = 0.075;
-
 int volatile current_bearing = 0;
-double ultrasonic_reading = 9999999;
+uint32_t ultrasonic_reading = 9999999;
 bool leftIRblack = false;
 bool rightIRblack = false;
-auto_init_mutex(wifiMutex);
 
 inline bool is_interrupt()
 {
@@ -44,492 +42,43 @@ inline bool is_interrupt()
     return num == 0;
 }
 
-err_t tcp_server_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
-{ // Receive data from the TCP connection.
-    // TCP_SERVER_T *state = (TCP_SERVER_T*)arg;  // Retrieve the server state from the argument.
-    if (!p)
-    {                                      // Check if the received packet buffer is invalid.
-        printf("Something went wrong!\n"); // Print an error message.
-        return ERR_BUF;
-    }
-    // cyw43_arch_lwip_check(); // Check the lwIP stack for readiness.
-    if (strlen(p->payload) == 0)
-    {                 // Check if the received data is empty.
-        pbuf_free(p); // Free the packet buffer.
-        return ERR_OK;
-    }
-    else if (p->tot_len > 0)
-    {                                                                    // Check if the total length of received data is greater than 0.
-        printf("Buffer value: %s, len is %d\n", p->payload, p->tot_len); // Print the received data.
-        if (strncmp(p->payload, "start", 5) == 0)
-        {
-            printf("starting\n");
-        }
-        if (strncmp(p->payload, "turncw", 6) == 0)
-        {
-            printf("turn cw\n");
-            int new_bearing = 90;
-            xMessageBufferSend(move_mode_buffer, "t", sizeof(char), 0);
-            xMessageBufferSend(turn_buffer, &new_bearing, sizeof(new_bearing), 0);
-        }
-        if (strncmp(p->payload, "turnccw", 7) == 0)
-        {
-            printf("turn ccw\n");
-            int new_bearing = -90;
-            xMessageBufferSend(move_mode_buffer, "t", sizeof(char), 0);
-            xMessageBufferSend(turn_buffer, &new_bearing, sizeof(new_bearing), 0);
-        }
-        if (strncmp(p->payload, "stop", 4) == 0)
-        {
-            int new_bearing = 0;
-            xMessageBufferSend(move_mode_buffer, "t", sizeof(char), 0);
-            xMessageBufferSend(turn_buffer, &new_bearing, sizeof(new_bearing), 0);
-        }
-        if (strncmp(p->payload, "set", 3) == 0)
-        {
-            char value[5] = "";
-            strncpy(value, p->payload + 4, 4); // 2d.p.
-            printf("value is %s\n", value);
-            printf("char is %c\n", *(char *)(p->payload + 3));
-            switch (*(char *)(p->payload + 3))
-            {
-            case 'p':
-                tkp = atof(value) / 10;
-                break;
-            case 'i':
-                tki = atof(value) / 10;
-                break;
-            case 'd':
-                tkd = atof(value) / 10;
-                break;
-            case '1':
-                fkp = atof(value) / 10;
-                break;
-            case '2':
-                fki = atof(value) / 10;
-                break;
-            case '3':
-                fkd = atof(value) / 10;
-                break;
-            }
-        }
-        if (strncmp(p->payload, "fwd", 3) == 0)
-        {
-            char value[4] = "";
-            strncpy(value, p->payload + 3, 4);
-            int dist = atoi(value);
-            xMessageBufferSend(move_mode_buffer, "f", sizeof(char), 0);
-            xMessageBufferSend(dist_buffer, &dist, sizeof(dist), 0);
-        }
-        if (strncmp(p->payload, "bar", 3) == 0)
-        {
-            int dist = 200;
-            xMessageBufferSend(move_mode_buffer, "b", sizeof(char), 0);
-            xMessageBufferSend(dist_buffer, &dist, sizeof(dist), 0);
-        }
-        if (strncmp(p->payload, "reset", 5) == 0){
-            reset_wheel_encoder();
-        }
-        while (!mutex_try_enter(&wifiMutex, 0))
-        {
-            printf("waiting for mutex\n");
-            sleep_ms(5);
-        }
-        xMessageBufferSend(wifiMsgBuffer, "ack\n", 5, 0);
-        mutex_exit(&wifiMutex);
-    }
-    // tcp_server_send_data(p, arg);  // Send a response to the client.
-    pbuf_free(p); // Free the packet buffer.
-    return ERR_OK;
-}
-
-void server_forward_task()
+// both line sensors share one handler, either edge re-reads the pair
+static void ir_handler(uint gpio, uint32_t events, void *ctx)
 {
-    // static const
-    while (1)
-    {
-        struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 256, PBUF_RAM);
-        xMessageBufferReceive(wifiMsgBuffer, (void *)p->payload, 256, portMAX_DELAY);
-        tcp_server_send_data(p, myServer);
-        pbuf_free(p);
-        taskYIELD();
-    }
-}
-
-void server_forward_task_from_ISR()
-{
-    // static const
-    while (1)
-    {
-        struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 256, PBUF_RAM);
-        while (xMessageBufferReceiveFromISR(wifiMsgBufferFromISR, (void *)p->payload, 256, NULL) == 0)
-            taskYIELD();
-        tcp_server_send_data(p, myServer);
-        pbuf_free(p);
-        taskYIELD();
-    }
+    leftIRblack = gpio_get(IR_LEFT_PIN);
+    rightIRblack = gpio_get(IR_RIGHT_PIN);
+    move_event_signal(MOVE_EVT_IR);
 }
 
-void mainIRQhandler(uint gpio, uint32_t events)
+// called from the lwIP callback for each new teleop setpoint
+void teleop_setpoint_callback(void)
 {
-    if (gpio == left_wheel_encoder_pin)
-    {
-        left_wheel_encoder_handler(events);
-        return;
-    }
-    if (gpio == right_wheel_encoder_pin)
-    {
-        right_wheel_encoder_handler(events);
-        return;
-    }
-    if (gpio == ADC_PIN)
-    {
-        barcode_handler(events);
-        return;
-    }
-    if (gpio == ECHO_PIN)
-    {
-        echocallback(events);
-        return;
-    }
+    move_event_signal(MOVE_EVT_TELEOP);
 }
 
-float get_bearing_error(float current, float target)
+// LogTask hands each formatted line to the clients subscribed to the log stream
+static void log_to_clients(const char *line)
 {
-    float error = target - current;
-    if (error > 180)
-        return error - 360;
-    if (error < -180)
-        return error + 360;
-    return error;
+    telemetry_publish(TLM_LOG, line);
 }
 
 void sense_task(__unused void *param){
+    bool obstacle = false;
     while(true){
         current_bearing = heading();
         ultrasonic_reading = getcm(TRI_PIN, ECHO_PIN);
         leftIRblack = gpio_get(IR_LEFT_PIN);
         rightIRblack = gpio_get(IR_RIGHT_PIN);
-
-        vTaskDelay(10);
-    }
-}
-
-void move_task(__unused void *params)
-{
-    int volatile target_bearing = current_bearing;
-    int volatile read_bearing = 0;
-    int update = 100;
-    char steadycount = 50;
-    // reading will be that of previous one
-
-    int volatile read_dist = 0;
-    uint64_t volatile target_code = 0;
-    char mode = 'p';
-    // f for forward
-    // b for barcode
-    // t for turn
-    // s for transition to reverse
-    // r for reverse
-    // p for paused
-
-    int volatile dist_error = 0;
-    int volatile dist_last_error = 0;
-
-    int volatile bearing_error = 0;
-    int volatile bearing_last_error = 0;
-    float volatile intergral = 0;
-    float volatile derivative = 0;
-    float volatile control = 0;
-    printf("taskrunning\n");
-
-    while (1)
-    {
-        xMessageBufferReceive(move_mode_buffer, (void *)&mode, sizeof(mode), 0);
-        bearing_error = get_bearing_error(current_bearing, target_bearing);
-
-        if (mode == 'p'){
-            stop();
-            if (--update == 0)
-            {
-                update = 100;
-                char update_data[100] = "";
-                snprintf(update_data, 100, "[P]lc:%llu\tlr:%llu\ttc:%llu\tec:%d\tcb:%d\ttb:%d\teb:%d\n", leftwheelcode, rightwheelcode, target_code, dist_error, current_bearing, target_bearing, bearing_error);
-                while (!mutex_try_enter(&wifiMutex, 0))
-                {
-                    vTaskDelay(5);
-                    stop();
-                }
-                xMessageBufferSend(wifiMsgBuffer, update_data, 100, 0);
-                mutex_exit(&wifiMutex);
-            }
-        }
-
-        if (mode == 'f')
-        {
-            if (xMessageBufferReceive(dist_buffer, (void *)&read_dist, sizeof(read_dist), 0))
-            {
-                if (read_dist > 0){
-                    printf("distanceBuffer: %d\n", read_dist);
-                    reset_wheel_encoder();
-                    target_code = read_dist;
-                }else if (read_dist == -1){
-                    target_code = 0;
-                }
-            }
-            // check for obsticles
-            if (ultrasonic_reading < 15){
-                target_code = 0;
-            }
-
-            dist_last_error = dist_error;
-            dist_error = target_code - leftwheelcode;
-            derivative = dist_error - dist_last_error;
-            // Code will increase going backwards too
-            if (dist_error < 2)
-            {
-                control = 0;
-                if (--steadycount == 0)
-                {
-                    if (dist_error < -2){
-                        stop();
-                        printf("lc was %llu, rc was %llu, set tc to %d\n", leftwheelcode, rightwheelcode, target_code);
-                        mode = 's'; //transition state to reverse
-                        steadycount = 50;
-                    }else{
-                        mode = 'p';
-                        steadycount = 50;
-                    }
-                }
-            }else{
-                control = fkp * dist_error;
-                steadycount = 50;
-            }
-            control += fkd * derivative;
-            if (control > 1)
-                control = 1;
-            set_speed(control * DEFAULT_SPEED);
-            if (leftwheelcode < rightwheelcode) {
-                right_tilt();
-            }
-            if (leftwheelcode > rightwheelcode) {
-                for(int i = leftwheelcode-rightwheelcode; i > 0; i -= 1){
-                    left_tilt();
-                }
-            }
-            if (leftIRblack){
-                right_tilt();
-                right_tilt();
-            }
-            if (rightIRblack){
-                left_tilt();
-                left_tilt();
-            }
-            forward();
-            
-            if (--update == 0)
-            {
-                update = 100;
-                char update_data[100] = "";
-                uint16_t speed = control * DEFAULT_SPEED;
-                snprintf(update_data, 100, "[FWD]lc:%llu\tlr:%llu\ttar:%llu\terr:%d\tctrl:%.2f\tp:%.3f\td:%.2f\tspeed:%d\n", leftwheelcode, rightwheelcode, target_code, dist_error, control, fkp, derivative, speed);
-                while (!mutex_try_enter(&wifiMutex, 0))
-                {
-                    vTaskDelay(5);
-                    stop();
-                }
-                xMessageBufferSend(wifiMsgBuffer, update_data, 100, 0);
-                mutex_exit(&wifiMutex);
-            }
-        }
-
-        if (mode == 'b')
+        telemetry_sample_bearing(current_bearing);
+        telemetry_sample_ultrasonic(ultrasonic_reading);
+        telemetry_poll();
+        // only wake move_task when the reading changes what it should do
+        if (obstacle != (ultrasonic_reading < OBSTACLE_CM))
         {
-            if (xMessageBufferReceive(dist_buffer, (void *)&read_dist, sizeof(read_dist), 0))
-            {
-                if (read_dist > 0){
-                    printf("distanceBuffer: %d\n", read_dist);
-                    reset_wheel_encoder();
-                    target_code = read_dist;
-                }
-            }
-            // check for obsticles
-            if (ultrasonic_reading < 15){
-                target_code = 0;
-            }
-
-            dist_last_error = dist_error;
-            dist_error = target_code - leftwheelcode;
-            derivative = dist_error - dist_last_error;
-            // Code will increase going backwards too
-            if (dist_error < 2)
-            {
-                control = 0;
-                if (--steadycount == 0)
-                {
-                    if (dist_error < -2){
-                        stop();
-                        printf("lc was %llu, rc was %llu, set tc to %d\n", leftwheelcode, rightwheelcode, target_code);
-                        mode = 's'; //transition state to reverse
-                        steadycount = 50;
-                    }else{
-                        mode = 'p';
-                        steadycount = 50;
-                    }
-                }
-            }else{
-                control = fkp * dist_error;
-                steadycount = 50;
-            }
-            control += fkd * derivative;
-            if (control > 1)
-                control = 1;
-            set_speed(control * DEFAULT_SPEED);
-            if (leftwheelcode < rightwheelcode) {
-                right_tilt();
-            }
-            if (leftwheelcode > rightwheelcode) {
-                for(int i = leftwheelcode-rightwheelcode; i > 0; i -= 1){
-                    left_tilt();
-                }
-            }
-            forward();
-            
-            if (--update == 0)
-            {
-                update = 100;
-                char update_data[100] = "";
-                uint16_t speed = control * DEFAULT_SPEED;
-                snprintf(update_data, 100, "[BAR]lc:%llu\tlr:%llu\ttar:%llu\terr:%d\tctrl:%.2f\tp:%.3f\td:%.2f\tspeed:%d\n", leftwheelcode, rightwheelcode, target_code, dist_error, control, fkp, derivative, speed);
-                while (!mutex_try_enter(&wifiMutex, 0))
-                {
-                    vTaskDelay(5);
-                    stop();
-                }
-                xMessageBufferSend(wifiMsgBuffer, update_data, 100, 0);
-                mutex_exit(&wifiMutex);
-            }
-        }
-
-        if (mode == 's'){
-            vTaskDelay(100); // wheels to stop completely
-            target_code = leftwheelcode;
-            printf("lc was %llu, rc was %llu, set tc to %d\n", leftwheelcode, rightwheelcode, target_code);
-            long long right_offset = rightwheelcode - leftwheelcode;
-            reset_wheel_encoder();
-            rightwheelcode = right_offset;
-            mode = 'r';
+            obstacle = !obstacle;
+            move_event_signal(MOVE_EVT_SENSOR);
         }
 
-        if (mode == 'r')
-        {
-            dist_last_error = dist_error;
-            dist_error = target_code - leftwheelcode;
-            derivative = dist_error - dist_last_error;
-            // Code will increase going backwards too
-            if (dist_error < 2)
-            {
-                control = 0;
-                if (--steadycount == 0)
-                {
-                    mode = 'p';
-                    steadycount = 50;
-                }
-            }else{
-                control = fkp * dist_error;
-                steadycount = 50;
-            }
-            control += fkd * derivative;
-            if (control > 1)
-                control = 1;
-            set_speed(control * DEFAULT_SPEED);
-            if (leftwheelcode < rightwheelcode) {
-                right_tilt();
-            }
-            if (leftwheelcode > rightwheelcode) {
-                left_tilt();
-            }
-            backwards();
-            
-            if (--update == 0)
-            {
-                update = 100;
-                char update_data[100] = "";
-                uint16_t speed = control * DEFAULT_SPEED;
-                snprintf(update_data, 100, "[RVE]lc:%llu\tlr:%llu\ttar:%llu\terr:%d\tctrl:%.2f\tp:%.3f\td:%.2f\tspeed:%d\n", leftwheelcode, rightwheelcode, target_code, dist_error, control, fkp, derivative, speed);
-                while (!mutex_try_enter(&wifiMutex, 0))
-                {
-                    vTaskDelay(5);
-                    stop();
-                }
-                xMessageBufferSend(wifiMsgBuffer, update_data, 100, 0);
-                mutex_exit(&wifiMutex);
-            }
-        }
-
-        if (mode == 't')
-        {
-            if (xMessageBufferReceive(turn_buffer, (void *)&read_bearing, sizeof(read_bearing), 0))
-            {
-                printf("readbearing: %d\n", read_bearing);
-                if (read_bearing == 0)
-                    target_bearing = current_bearing;
-                target_bearing += read_bearing;
-                if (target_bearing > 360)
-                    target_bearing -= 360;
-                if (target_bearing < 0)
-                    target_bearing += 360;
-            }
-            bearing_last_error = bearing_error;
-            intergral += bearing_error;
-            derivative = bearing_error - bearing_last_error;
-
-            if (abs(bearing_error) > 3)
-            {
-                control = tkp * bearing_error;
-                steadycount = 50;
-            }
-            else
-            {
-                if (--steadycount == 0)
-                {
-                    mode = 'p';
-                    steadycount = 50;
-                }
-                control = 0;
-            }
-            control += tki * intergral + tkd * derivative;
-
-            if (control > 0)
-            {
-                // set direction here
-                rotate_clockwise();
-            }
-            else
-            {
-                rotate_counter_clockwise();
-            }
-            if (control < 0)
-                control = -control;
-            if (control > 1)
-                control = 1;
-            set_speed(control * DEFAULT_SPEED);
-            if (--update == 0)
-            {
-                update = 100;
-                char update_data[100] = "";
-                uint16_t speed = control * DEFAULT_SPEED;
-                snprintf(update_data, 100, "[TUN]cur:%d\ttar:%d\terr:%d\tctrl:%f\tp:%.3f\tspeed:%d\n", current_bearing, target_bearing, bearing_error, control, tkp, speed);
-                while (!mutex_try_enter(&wifiMutex, 0))
-                {
-                    printf("waiting for mutex\n");
-                    vTaskDelay(5);
-                    stop();
-                }
-                xMessageBufferSend(wifiMsgBuffer, update_data, 100, 0);
-                mutex_exit(&wifiMutex);
-            }
-        }
         vTaskDelay(10);
     }
 }
@@ -537,7 +86,6 @@ void move_task(__unused void *params)
 void calibrate_task(){
     char calibuffer[100] = "run";
 
-    int update = 200;
     int16_t x, y, z;
     while(1){
         // xMessageBufferReceive(irLeftBuffer, (void *)&calibuffer, sizeof(calibuffer), 0);
@@ -551,16 +99,10 @@ void calibrate_task(){
         m_max.y = MAX(m_max.y, y);
         m_max.z = MAX(m_max.z, z);
         
-        if (--update == 0){
-            update = 200;
+        if (telemetry_due(TLM_CAL)){
             char update_data[100] = "";
             snprintf(update_data, 100, "[CAL]min: x:%d\ty%d\tz%d[CAL]max: x:%d\ty:%d\tz:%d\n", m_min.x, m_min.y, m_min.z, m_max.x, m_max.y, m_max.z);
-            while (!mutex_try_enter(&wifiMutex, 0))
-            {
-                vTaskDelay(5);
-            }
-            xMessageBufferSend(wifiMsgBuffer, update_data, 100, 0);
-            mutex_exit(&wifiMutex);
+            telemetry_publish(TLM_CAL, update_data);
         }
         vTaskDelay(10);
     }
@@ -574,22 +116,21 @@ void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName ){
 void vLaunch(void)
 {
 
-    move_mode_buffer = xMessageBufferCreate(mbaTASK_MESSAGE_BUFFER_SIZE);
-    turn_buffer = xMessageBufferCreate(mbaTASK_MESSAGE_BUFFER_SIZE);
-    dist_buffer = xMessageBufferCreate(mbaTASK_MESSAGE_BUFFER_SIZE);
+    command_init();
 
-    TaskHandle_t server_sampleRecv;    // Create a task handle for the server task.
-    TaskHandle_t server_sampleRecvISR; // Create a task handle for the server task.
+    TaskHandle_t server_tx;            // Create a task handle for the server task.
     TaskHandle_t movement_task;                // Create a task handle for the server task.
     TaskHandle_t sensor_task;                // Create a task handle for the server task.
-    wifiMsgBuffer = xMessageBufferCreate(256);
-    wifiMsgBufferFromISR = xMessageBufferCreate(256);
+    TaskHandle_t udp_stream;
+    TaskHandle_t logger;
 
     printf("creating tasks\n");
     xTaskCreate(move_task, "TurningTask", configMINIMAL_STACK_SIZE * 4, NULL, 2, &movement_task);                                         // Create the server task.
-    xTaskCreate(sense_task, "SensorTask", configMINIMAL_STACK_SIZE, NULL, 3, &sensor_task);                                         // Create the server task.
-    xTaskCreate(server_forward_task, "ServerForwardTask", configMINIMAL_STACK_SIZE * 2, NULL, 1, &server_sampleRecv);              // Create the server task.
-    xTaskCreate(server_forward_task_from_ISR, "ServerForwardTaskISR", configMINIMAL_STACK_SIZE * 2, NULL, 1, &server_sampleRecvISR); // Create the server task.
+    xTaskCreate(sense_task, "SensorTask", configMINIMAL_STACK_SIZE * 2, NULL, 3, &sensor_task);                                         // Create the server task.
+    xTaskCreate(server_tx_task, "ServerTxTask", configMINIMAL_STACK_SIZE * 2, NULL, 1, &server_tx);                                   // Create the server task.
+    xTaskCreate(stream_task, "StreamTask", configMINIMAL_STACK_SIZE * 2, NULL, 1, &udp_stream);
+    log_set_sink(log_to_clients);
+    xTaskCreate(log_task, "LogTask", configMINIMAL_STACK_SIZE * 2, NULL, tskIDLE_PRIORITY + 1, &logger);
     printf("starting tasks\n");
     vTaskStartScheduler();
     printf("task scheduler failed to hold");
@@ -600,7 +141,9 @@ int main()
     stdio_init_all(); // Initialize standard I/O.
 
     initWifi();
+    remote_init();
     start_server(NULL);
+    teleop_start(teleop_setpoint_callback);
 
     gpio_init(IR_LEFT_PIN);
     gpio_init(IR_RIGHT_PIN);
@@ -617,13 +160,16 @@ int main()
     initalize_acc(); // Configure the accelerometer.
     initalize_mag(); // Configure the magnetometer.
 
-    gpio_set_irq_callback(&mainIRQhandler);
-    gpio_set_irq_enabled(left_wheel_encoder_pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
-    gpio_set_irq_enabled(right_wheel_encoder_pin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
-    gpio_set_irq_enabled(ADC_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
-    gpio_set_irq_enabled(ECHO_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
-    gpio_set_irq_enabled(IR_LEFT_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
-    gpio_set_irq_enabled(IR_RIGHT_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    isrstats_init();
+    gpioirq_init();
+    const uint32_t both_edges = GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL;
+    gpioirq_register(left_wheel_encoder_pin, both_edges, left_wheel_encoder_handler, NULL);
+    gpioirq_register(right_wheel_encoder_pin, both_edges, right_wheel_encoder_handler, NULL);
+    gpioirq_register(ADC_PIN, both_edges, barcode_handler, NULL);
+    gpioirq_register(ECHO_PIN, both_edges, echocallback, NULL);
+    gpioirq_register(IR_LEFT_PIN, both_edges, ir_handler, NULL);
+    gpioirq_register(IR_RIGHT_PIN, both_edges, ir_handler, NULL);
+    irqbench_init();
 
     vLaunch();
     // vTaskStartScheduler();  // Start the FreeRTOS task scheduler.
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include "command.h"
+#include "events.h"
+#include "trace.h"
+
+static QueueHandle_t command_queue = NULL;
+static uint32_t next_seq = 0;
+static command_stats stats = {.latency_min_us = UINT32_MAX};
+
+void command_init(void)
+{
+    command_queue = xQueueCreate(COMMAND_QUEUE_LENGTH, sizeof(move_cmd));
+}
+
+bool command_post(uint8_t op, int32_t arg0, int32_t arg1)
+{
+    move_cmd cmd = {.op = op, .arg = {arg0, arg1}};
+    return command_post_cmd(&cmd);
+}
+
+static UBaseType_t counters_lock(bool isr)
+{
+    if (isr)
+        return taskENTER_CRITICAL_FROM_ISR();
+    taskENTER_CRITICAL();
+    return 0;
+}
+
+static void counters_unlock(bool isr, UBaseType_t irq)
+{
+    if (isr)
+        taskEXIT_CRITICAL_FROM_ISR(irq);
+    else
+        taskEXIT_CRITICAL();
+}
+
+// Stamp and queue a command, then wake move_task. Safe from tasks and the lwIP callback.
+// The queue API may not be called inside a critical section, so only the
+// counters are locked.
+bool command_post_cmd(move_cmd *cmd)
+{
+    bool isr = portCHECK_IF_IN_ISR();
+    UBaseType_t irq = counters_lock(isr);
+    cmd->timestamp_us = time_us_32();
+    cmd->seq = next_seq++;
+    counters_unlock(isr, irq);
+
+    BaseType_t ok = isr ? xQueueSendToBackFromISR(command_queue, cmd, NULL)
+                        : xQueueSendToBack(command_queue, cmd, 0);
+
+    irq = counters_lock(isr);
+    if (ok == pdTRUE)
+        ++stats.posted;
+    else
+        ++stats.dropped;
+    counters_unlock(isr, irq);
+    if (ok != pdTRUE)
+        return false;
+    move_event_signal(MOVE_EVT_COMMAND);
+    return true;
+}
+
+bool command_receive(move_cmd *cmd)
+{
+    return xQueueReceive(command_queue, cmd, 0) == pdTRUE;
+}
+
+bool command_pending(void)
+{
+    return uxQueueMessagesWaiting(command_queue) > 0;
+}
+
+// Record post to apply latency once move_task has acted on a command.
+void command_applied(const move_cmd *cmd)
+{
+    uint32_t latency = time_us_32() - cmd->timestamp_us;
+    trace_event(TRACE_APPLIED, cmd->op, cmd->seq);
+    ++stats.applied;
+    stats.latency_sum_us += latency;
+    if (latency < stats.latency_min_us)
+        stats.latency_min_us = latency;
+    if (latency > stats.latency_max_us)
+        stats.latency_max_us = latency;
+}
+
+int command_report(char *out, int len)
+{
+    return snprintf(out, len, "[CMD]seq:%lu\tposted:%lu\tapplied:%lu\tdropped:%lu\tlat:%lu/%lu/%lu us\n",
+                    next_seq, stats.posted, stats.applied, stats.dropped,
+                    stats.applied ? stats.latency_min_us : 0,
+                    stats.applied ? (uint32_t)(stats.latency_sum_us / stats.applied) : 0,
+                    stats.latency_max_us);
+}
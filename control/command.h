@@ -0,0 +1,51 @@
+#ifndef command_h
+#define command_h
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+
+// Movement commands travel as one fixed size struct through one queue, so
+// move_task always sees an opcode together with its arguments.
+
+typedef enum cmd_opcode_ {
+    CMD_STOP,
+    CMD_FWD,   // arg[0] encoder edges, -1 cancels the current move
+    CMD_BAR,   // arg[0] encoder edges to scan over
+    CMD_TURN,  // arg[0] degrees relative to the current target, + is clockwise
+    CMD_BENCH, // arg[0] 0 fixed point, 1 interrupt latency
+    CMD_CHAR,
+    CMD_WAIT,    // arg[0] 1 holds until an obstacle is in range, 0 until the path is clear
+    CMD_MISSION, // run the mission last uploaded with mission_load
+    CMD_TELEOP,  // follow the UDP velocity setpoints until the next command
+    CMD_ARC,     // arg[0] radius mm, arg[1] degrees to sweep, + is clockwise
+    CMD_GOTO,    // arg[0],arg[1] x,y mm in the odometry frame, arg[2] final heading or CMD_NO_HEADING
+    CMD_COUNT
+} cmd_opcode;
+
+typedef struct move_cmd_ {
+    uint8_t op;
+    int32_t arg[3];
+    uint32_t seq;
+    uint32_t timestamp_us; // when it was posted
+} move_cmd;
+
+typedef struct command_stats_ {
+    uint32_t posted;
+    uint32_t applied;
+    uint32_t dropped; // queue full
+    uint32_t latency_min_us, latency_max_us;
+    uint64_t latency_sum_us;
+} command_stats;
+
+#define COMMAND_QUEUE_LENGTH 16
+#define CMD_NO_HEADING INT32_MIN
+
+void command_init(void);
+bool command_post(uint8_t op, int32_t arg0, int32_t arg1);
+bool command_post_cmd(move_cmd *cmd);
+bool command_receive(move_cmd *cmd);
+bool command_pending(void);
+void command_applied(const move_cmd *cmd);
+int command_report(char *out, int len);
+
+#endif
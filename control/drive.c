@@ -0,0 +1,82 @@
+#include "drive.h"
+#include "motor.h"
+#include "feedforward.h"
+#include "looptimer.h"
+#include "hotpath.h"
+
+volatile q16_t drive_kp = Q16(15), drive_ki = Q16(0.1), drive_ksync = Q16(4); // ki is per inner period
+wheel_ctrl left_wheel, right_wheel;
+
+static bool drive_active = false;
+static long long left_base = 0, right_base = 0;
+// Q16 edges, the count difference the targets should have built up since the
+// bases, so a held steer is not synced away. sync_step is added every update.
+static int64_t sync_expected = 0;
+static q16_t sync_step = 0;
+
+void drive_init(void)
+{
+    uint16_t wrap = get_pwm_wrap();
+    pid_init(&left_wheel.pid, drive_kp, drive_ki, 0, 0, wrap);
+    pid_init(&right_wheel.pid, drive_kp, drive_ki, 0, 0, wrap);
+    ff_init();
+    drive_reset();
+}
+
+void drive_reset(void)
+{
+    pid_reset(&left_wheel.pid);
+    pid_reset(&right_wheel.pid);
+    left_wheel.target = right_wheel.target = 0;
+    left_wheel.pwm = right_wheel.pwm = 0;
+    left_base = leftwheelcode;
+    right_base = rightwheelcode;
+    sync_expected = 0;
+    sync_step = 0;
+    drive_active = false;
+}
+
+// speed is the common target in edges/s, steer is left minus right
+void drive_set_target(int32_t speed, int32_t steer)
+{
+    left_wheel.target = speed + steer / 2;
+    right_wheel.target = speed - steer / 2;
+    // a wheel with a target <= 0 is stopped, it adds nothing to the difference
+    int32_t diff = MAX(left_wheel.target, 0) - MAX(right_wheel.target, 0);
+    sync_step = Q16_FROM_INT(diff) / (int32_t)looptimer_rate();
+    drive_active = true;
+}
+
+static uint16_t HOT(wheel_update)(wheel_ctrl *wheel, int side, int32_t target)
+{
+    wheel->pid.kp = drive_kp;
+    wheel->pid.ki = drive_ki;
+    if (target <= 0)
+    {
+        pid_reset(&wheel->pid);
+        return wheel->pwm = 0;
+    }
+    // start from the measured duty for this speed, the PI only trims the error
+    int32_t feedforward = ff_pwm(side, target);
+    return wheel->pwm = pid_update(&wheel->pid, target - wheel->speed, feedforward);
+}
+
+// Inner loop, call every control period. Does nothing until a target is set
+// so other modes can drive the PWM directly.
+void HOT(drive_update)(void)
+{
+    if (!drive_active)
+        return;
+
+    left_wheel.speed = left_wheel_speed();
+    right_wheel.speed = right_wheel_speed();
+
+    // ahead of the expected difference -> slow down, the other wheel speeds up
+    sync_expected += sync_step;
+    int32_t count_diff = (leftwheelcode - left_base) - (rightwheelcode - right_base) - (int32_t)((sync_expected + Q16_ONE / 2) >> Q16_SHIFT);
+    int32_t sync = q16_to_int(q16_mul_int(drive_ksync, count_diff));
+    int32_t left_target = left_wheel.target > 0 ? left_wheel.target - sync : 0;
+    int32_t right_target = right_wheel.target > 0 ? right_wheel.target + sync : 0;
+
+    set_wheel_speeds(wheel_update(&left_wheel, FF_LEFT, left_target), wheel_update(&right_wheel, FF_RIGHT, right_target));
+}
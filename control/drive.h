@@ -0,0 +1,31 @@
+#ifndef drive_h
+#define drive_h
+#include "pid.h"
+
+// Per wheel velocity control. Each wheel has its own PI loop on encoder
+// speed (edges/s) and a synchronisation term on the encoder count difference
+// so the car holds a straight line without tilting one channel. The sync
+// reference follows the steer target, so a held steer still turns.
+// This is the inner loop of the cascade, it runs faster than the position
+// loop that calls drive_set_target.
+
+#define DRIVE_MAX_SPEED 150   // edges/s the outer loop scales its 0..1 output to
+#define DRIVE_MAX_ACCEL 300   // edges/s^2 for motion profiles
+#define DRIVE_IR_STEER 40     // edges/s differential when an IR sensor sees the line
+
+typedef struct wheel_ctrl_ {
+    pid_ctrl pid;
+    int32_t target; // edges/s
+    int32_t speed;  // edges/s, measured
+    uint16_t pwm;
+} wheel_ctrl;
+
+extern volatile q16_t drive_kp, drive_ki, drive_ksync;
+extern wheel_ctrl left_wheel, right_wheel;
+
+void drive_init(void);
+void drive_reset(void);
+void drive_set_target(int32_t speed, int32_t steer);
+void drive_update(void);
+
+#endif
@@ -0,0 +1,34 @@
+#include "events.h"
+#include "hotpath.h"
+
+static TaskHandle_t move_task_handle = NULL;
+
+void move_events_init(TaskHandle_t task)
+{
+    move_task_handle = task;
+}
+
+// Safe from both task and interrupt context (the lwIP callbacks run in an IRQ).
+void HOT(move_event_signal)(uint32_t bits)
+{
+    if (move_task_handle == NULL)
+        return;
+    if (portCHECK_IF_IN_ISR())
+    {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(move_task_handle, bits, eSetBits, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+    else
+    {
+        xTaskNotify(move_task_handle, bits, eSetBits);
+    }
+}
+
+// Block until any event arrives, returns the bits that were set (0 on timeout).
+uint32_t move_event_wait(TickType_t timeout)
+{
+    uint32_t bits = 0;
+    xTaskNotifyWait(0, UINT32_MAX, &bits, timeout);
+    return bits;
+}
@@ -0,0 +1,20 @@
+#ifndef events_h
+#define events_h
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Wake reasons for move_task, delivered as task notification bits so one
+// xTaskNotifyWait covers commands, sensors, encoder targets and the loop tick.
+#define MOVE_EVT_TICK    (1u << 0) // control period from looptimer
+#define MOVE_EVT_COMMAND (1u << 1) // new entry in the command buffers
+#define MOVE_EVT_SENSOR  (1u << 2) // sense_task saw something the controller must react to
+#define MOVE_EVT_ENCODER (1u << 3) // a wheel reached its encoder target
+#define MOVE_EVT_IR      (1u << 4) // IR line sensor edge
+#define MOVE_EVT_MODE    (1u << 5) // move_task changed its own mode
+#define MOVE_EVT_TELEOP  (1u << 6) // new teleop setpoint, latest wins so it is not queued
+
+void move_events_init(TaskHandle_t task);
+void move_event_signal(uint32_t bits);
+uint32_t move_event_wait(TickType_t timeout);
+
+#endif
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <string.h>
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include "feedforward.h"
+#include "hotpath.h"
+#include "motor.h"
+
+#define FF_MAGIC 0x46465443 // "FFTC", bumped when the stored speeds change meaning
+#define FF_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+
+// sweep timing in outer loop ticks (100Hz)
+#define FF_SETTLE_TICKS 50
+#define FF_SAMPLE_TICKS 25
+
+// used until a sweep has been run, the old linear guess in drive.c (deadband
+// 1200 and 30 levels per edge/s at wrap 6250) as fractions of the wrap
+#define FF_DEFAULT_DEADBAND_PERMILLE 192
+#define FF_DEFAULT_TOP_SPEED 168 // edges/s at full duty
+
+ff_table ff;
+
+static int sweep_step = 0;
+static int sweep_tick = 0;
+static int32_t sweep_sum[2] = {0};
+
+void ff_init(void)
+{
+    const ff_table *stored = (const ff_table *)(XIP_BASE + FF_FLASH_OFFSET);
+    uint16_t wrap = get_pwm_wrap();
+    if (stored->magic == FF_MAGIC && stored->pwm[FF_POINTS - 1] == wrap)
+    {
+        ff = *stored;
+        return;
+    }
+    ff.magic = FF_MAGIC;
+    uint32_t deadband = (uint32_t)wrap * FF_DEFAULT_DEADBAND_PERMILLE / 1000;
+    for (int i = 0; i < FF_POINTS; ++i)
+    {
+        ff.pwm[i] = (uint32_t)wrap * i / (FF_POINTS - 1);
+        int32_t speed = ff.pwm[i] > deadband ? (ff.pwm[i] - deadband) * FF_DEFAULT_TOP_SPEED / (wrap - deadband) : 0;
+        ff.speed[FF_LEFT][i] = ff.speed[FF_RIGHT][i] = speed;
+    }
+}
+
+// Lowest sweep level that moved the wheel.
+uint16_t ff_deadband(int wheel)
+{
+    for (int i = 0; i < FF_POINTS; ++i)
+        if (ff.speed[wheel][i] > 0)
+            return ff.pwm[i];
+    return ff.pwm[FF_POINTS - 1];
+}
+
+// Inverse lookup: PWM level for a target speed, linear between sweep points.
+uint16_t HOT(ff_pwm)(int wheel, int32_t speed)
+{
+    const int16_t *s = ff.speed[wheel];
+    if (speed <= 0)
+        return 0;
+    if (speed >= s[FF_POINTS - 1])
+        return ff.pwm[FF_POINTS - 1];
+    int i = 1;
+    while (s[i] <= speed)
+        ++i;
+    // s[i - 1] <= speed < s[i]
+    if (s[i - 1] == 0)
+        return ff.pwm[i - 1] + (int32_t)(ff.pwm[i] - ff.pwm[i - 1]) * speed / s[i];
+    return ff.pwm[i - 1] + (int32_t)(ff.pwm[i] - ff.pwm[i - 1]) * (speed - s[i - 1]) / (s[i] - s[i - 1]);
+}
+
+void ff_characterize_start(void)
+{
+    uint16_t wrap = get_pwm_wrap();
+    for (int i = 0; i < FF_POINTS; ++i)
+        ff.pwm[i] = (uint32_t)wrap * i / (FF_POINTS - 1);
+    sweep_step = 0;
+    sweep_tick = 0;
+    sweep_sum[FF_LEFT] = sweep_sum[FF_RIGHT] = 0;
+    set_wheel_speeds(0, 0);
+}
+
+// One outer loop tick of the sweep, returns true when the table is complete.
+// Each level is held for FF_SETTLE_TICKS, then speed is averaged over FF_SAMPLE_TICKS.
+bool ff_characterize_step(void)
+{
+    if (sweep_step >= FF_POINTS)
+        return true;
+    set_wheel_speeds(ff.pwm[sweep_step], ff.pwm[sweep_step]);
+    if (++sweep_tick <= FF_SETTLE_TICKS)
+        return false;
+
+    sweep_sum[FF_LEFT] += left_wheel_speed();
+    sweep_sum[FF_RIGHT] += right_wheel_speed();
+    if (sweep_tick < FF_SETTLE_TICKS + FF_SAMPLE_TICKS)
+        return false;
+
+    for (int wheel = FF_LEFT; wheel <= FF_RIGHT; ++wheel)
+    {
+        int32_t speed = sweep_sum[wheel] / FF_SAMPLE_TICKS;
+        // keep the curve monotonic so the inverse lookup is well defined
+        if (sweep_step > 0 && speed <= ff.speed[wheel][sweep_step - 1])
+            speed = ff.speed[wheel][sweep_step - 1] + (speed > 0 ? 1 : 0);
+        ff.speed[wheel][sweep_step] = speed;
+        sweep_sum[wheel] = 0;
+    }
+    sweep_tick = 0;
+    if (++sweep_step < FF_POINTS)
+        return false;
+    set_wheel_speeds(0, 0);
+    return true;
+}
+
+// Erase and program the last sector. Interrupts are off for the erase
+// (tens of ms), only call this with the car stopped.
+void ff_save(void)
+{
+    static uint8_t page[FLASH_PAGE_SIZE];
+    memset(page, 0xff, sizeof(page));
+    ff.magic = FF_MAGIC;
+    memcpy(page, &ff, sizeof(ff));
+
+    uint32_t irq = save_and_disable_interrupts();
+    flash_range_erase(FF_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(FF_FLASH_OFFSET, page, FLASH_PAGE_SIZE);
+    restore_interrupts(irq);
+}
+
+// One line per wheel, returns 0 when done.
+int ff_report(char *out, int len, int line)
+{
+    if (line > FF_RIGHT)
+        return 0;
+    int n = snprintf(out, len, "[FF]%c db:%u", line == FF_LEFT ? 'L' : 'R', ff_deadband(line));
+    for (int i = 0; i < FF_POINTS && n < len; ++i)
+        n += snprintf(out + n, len - n, ":%d", ff.speed[line][i]);
+    if (n < len)
+        n += snprintf(out + n, len - n, "\n");
+    return n;
+}
@@ -0,0 +1,30 @@
+#ifndef feedforward_h
+#define feedforward_h
+#include "pico/stdlib.h"
+
+// Measured duty -> wheel speed curve per wheel, inverted to give the PWM
+// level that should hold a target speed. Filled by an on-device sweep
+// ("char" command, run with the wheels off the ground) and kept in the
+// last flash sector across resets.
+
+#define FF_POINTS 16
+#define FF_LEFT 0
+#define FF_RIGHT 1
+
+typedef struct ff_table_ {
+    uint32_t magic;
+    uint16_t pwm[FF_POINTS];                 // sweep levels, 0..wrap
+    int16_t speed[2][FF_POINTS];             // steady state edges/s at each level
+} ff_table;
+
+extern ff_table ff;
+
+void ff_init(void);
+uint16_t ff_pwm(int wheel, int32_t speed);
+uint16_t ff_deadband(int wheel);
+void ff_characterize_start(void);
+bool ff_characterize_step(void);
+void ff_save(void);
+int ff_report(char *out, int len, int line);
+
+#endif
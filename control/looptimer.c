@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <string.h>
+#include "looptimer.h"
+#include "events.h"
+#include "hotpath.h"
+
+static repeating_timer_t loop_timer;
+static bool loop_enabled = false;
+static volatile uint32_t loop_period_us = 1000000 / LOOPTIMER_DEFAULT_HZ;
+static looptimer_stats stats;
+static uint32_t last_wake_us = 0;
+// alarms fired vs handled, the notification bit alone can't count missed periods
+static volatile uint32_t ticks_fired = 0;
+static uint32_t ticks_handled = 0;
+
+static uint hist_bin(uint32_t us)
+{
+    uint bin = us ? 32 - __builtin_clz(us) : 0;
+    return bin < LOOPTIMER_BINS ? bin : LOOPTIMER_BINS - 1;
+}
+
+// Alarm IRQ: wake the control task. Writing delay_us lets the rate change
+// take effect on the next period without cancelling the alarm.
+static bool HOT(looptimer_callback)(repeating_timer_t *rt)
+{
+    rt->delay_us = -(int64_t)loop_period_us;
+    ++ticks_fired;
+    move_event_signal(MOVE_EVT_TICK);
+    return true;
+}
+
+void looptimer_init(uint32_t hz)
+{
+    if (hz == 0 || hz > LOOPTIMER_MAX_HZ)
+        hz = LOOPTIMER_DEFAULT_HZ;
+    loop_period_us = 1000000 / hz;
+    looptimer_reset_stats();
+}
+
+// Only tick while a controller is running, an idle move_task just waits for events.
+// False if the alarm pool had no slot left, the loop is then not ticking.
+bool looptimer_enable(bool enable)
+{
+    if (enable == loop_enabled)
+        return true;
+    if (!enable)
+    {
+        loop_enabled = false;
+        cancel_repeating_timer(&loop_timer);
+        return true;
+    }
+    last_wake_us = 0; // don't count the idle gap as jitter
+    ticks_handled = ticks_fired;
+    // negative delay means the period is measured start to start, so the body length does not add drift
+    loop_enabled = add_repeating_timer_us(-(int64_t)loop_period_us, looptimer_callback, NULL, &loop_timer);
+    return loop_enabled;
+}
+
+bool looptimer_enabled(void)
+{
+    return loop_enabled;
+}
+
+bool looptimer_set_rate(uint32_t hz)
+{
+    if (hz == 0 || hz > LOOPTIMER_MAX_HZ)
+        return false;
+    loop_period_us = 1000000 / hz;
+    looptimer_reset_stats();
+    return true;
+}
+
+uint32_t looptimer_rate(void)
+{
+    return 1000000 / loop_period_us;
+}
+
+void looptimer_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    stats.period_us = loop_period_us;
+    last_wake_us = 0;
+}
+
+// Call when woken by MOVE_EVT_TICK, returns the measured period in us.
+uint32_t looptimer_mark_wake(void)
+{
+    uint32_t fired = ticks_fired;
+    uint32_t pending = fired - ticks_handled;
+    uint32_t now = time_us_32();
+    uint32_t period = now - last_wake_us;
+
+    ticks_handled = fired;
+    if (pending > 1)
+        stats.overruns += pending - 1;
+    if (last_wake_us != 0)
+    {
+        uint32_t jitter = period > stats.period_us ? period - stats.period_us : stats.period_us - period;
+        ++stats.jitter_hist[hist_bin(jitter)];
+        if (jitter > stats.jitter_max_us)
+            stats.jitter_max_us = jitter;
+    }
+    last_wake_us = now;
+    return period;
+}
+
+void looptimer_body_done(void)
+{
+    uint32_t body = time_us_32() - last_wake_us;
+    ++stats.body_hist[hist_bin(body)];
+    if (body > stats.body_max_us)
+        stats.body_max_us = body;
+    ++stats.count;
+}
+
+const looptimer_stats *looptimer_get_stats(void)
+{
+    return &stats;
+}
+
+// Report is split into lines short enough for one server message.
+// Returns 0 once there are no more lines.
+int looptimer_report(char *out, int len, int line)
+{
+    const uint32_t *hist;
+    switch (line)
+    {
+    case 0:
+        return snprintf(out, len, "[JIT]hz:%lu\tn:%lu\tovr:%lu\tjmax:%lu\tbmax:%lu\n",
+                        1000000 / stats.period_us, stats.count, stats.overruns, stats.jitter_max_us, stats.body_max_us);
+    case 1:
+        hist = stats.jitter_hist;
+        break;
+    case 2:
+        hist = stats.body_hist;
+        break;
+    default:
+        return 0;
+    }
+    int n = snprintf(out, len, line == 1 ? "[JIT]jit" : "[JIT]body");
+    for (int i = 0; i < LOOPTIMER_BINS && n < len; ++i)
+        n += snprintf(out + n, len - n, ":%lu", hist[i]);
+    if (n < len)
+        n += snprintf(out + n, len - n, "\n");
+    return n;
+}
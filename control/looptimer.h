@@ -0,0 +1,34 @@
+#ifndef looptimer_h
+#define looptimer_h
+#include "pico/stdlib.h"
+
+// Paces a task off a repeating hardware alarm instead of vTaskDelay, and keeps
+// log2 histograms of period jitter and body execution time. Each period is
+// delivered to move_task as MOVE_EVT_TICK.
+
+#define LOOPTIMER_DEFAULT_HZ 100 // same period as the old vTaskDelay(10)
+#define LOOPTIMER_MAX_HZ 1000
+#define LOOPTIMER_BINS 12 // bin 0 is 0us, bin n is [2^(n-1), 2^n) us, last bin catches the rest
+
+typedef struct looptimer_stats_ {
+    uint32_t period_us;
+    uint32_t count;
+    uint32_t overruns; // alarms that fired while the body was still running
+    uint32_t jitter_max_us;
+    uint32_t body_max_us;
+    uint32_t jitter_hist[LOOPTIMER_BINS];
+    uint32_t body_hist[LOOPTIMER_BINS];
+} looptimer_stats;
+
+void looptimer_init(uint32_t hz);
+bool looptimer_enable(bool enable);
+bool looptimer_enabled(void);
+bool looptimer_set_rate(uint32_t hz);
+uint32_t looptimer_rate(void);
+uint32_t looptimer_mark_wake(void);
+void looptimer_body_done(void);
+void looptimer_reset_stats(void);
+const looptimer_stats *looptimer_get_stats(void);
+int looptimer_report(char *out, int len, int line);
+
+#endif
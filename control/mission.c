@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "mission.h"
+
+#define MISSION_BAR_EDGES 200
+
+typedef struct mission_word_ {
+    const char *word;
+    uint8_t op;
+    int32_t arg;    // used when no number follows
+    bool needs_arg;
+} mission_word;
+
+static const mission_word words[] = {
+    {"fwd", CMD_FWD, 0, true},
+    {"turn", CMD_TURN, 0, true},
+    {"bar", CMD_BAR, MISSION_BAR_EDGES, false},
+    {"wait", CMD_WAIT, 1, false},
+    {"clear", CMD_WAIT, 0, false},
+};
+#define NUM_WORDS (sizeof(words) / sizeof(words[0]))
+
+// written by the server, copied to steps when move_task takes the CMD_MISSION
+static mission_step pending[MISSION_MAX_STEPS];
+static int pending_count = 0;
+
+static mission_step steps[MISSION_MAX_STEPS];
+static int step_count = 0;
+static int step_next = 0;
+static bool running = false;
+static bool completed = false; // the last mission ran out of steps rather than being aborted
+static uint32_t mission_start_us = 0;
+static uint32_t step_start_us = 0;
+static uint32_t last_step_us = 0;
+
+static const char *op_name(uint8_t op, int32_t arg)
+{
+    for (int i = 0; i < NUM_WORDS; ++i)
+        if (words[i].op == op && (op != CMD_WAIT || words[i].arg == arg))
+            return words[i].word;
+    return "?";
+}
+
+// Parse an optionally signed decimal at s, the payload is not NUL terminated
+static int parse_int(const char *s, const char *end, int32_t *value)
+{
+    const char *p = s;
+    bool neg = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = *p++ == '-';
+    const char *digits = p;
+    int32_t v = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+        v = v * 10 + (*p++ - '0');
+    if (p == digits)
+        return 0;
+    *value = neg ? -v : v;
+    return p - s;
+}
+
+// Parse a mission and keep it until move_task starts it. Safe from the lwIP
+// callback. Returns the number of steps, or -1 if the text didn't parse.
+int mission_load(const char *text, int len)
+{
+    mission_step parsed[MISSION_MAX_STEPS];
+    int count = 0;
+    const char *p = text, *end = text + len;
+    while (p < end && *p)
+    {
+        if (*p == ' ' || *p == ';' || *p == ',' || *p == '\r' || *p == '\n')
+        {
+            ++p;
+            continue;
+        }
+        const mission_word *w = NULL;
+        for (int i = 0; i < NUM_WORDS; ++i)
+        {
+            int n = strlen(words[i].word);
+            if (end - p >= n && strncmp(p, words[i].word, n) == 0)
+            {
+                w = &words[i];
+                p += n;
+                break;
+            }
+        }
+        if (!w || count == MISSION_MAX_STEPS)
+            return -1;
+        while (p < end && *p == ' ')
+            ++p;
+        int32_t arg = w->arg;
+        int n = parse_int(p, end, &arg);
+        if (n == 0 && w->needs_arg)
+            return -1;
+        p += n;
+        parsed[count].op = w->op;
+        parsed[count].arg = arg;
+        ++count;
+    }
+    if (count == 0)
+        return -1;
+
+    if (portCHECK_IF_IN_ISR())
+    {
+        UBaseType_t irq = taskENTER_CRITICAL_FROM_ISR();
+        memcpy(pending, parsed, count * sizeof(mission_step));
+        pending_count = count;
+        taskEXIT_CRITICAL_FROM_ISR(irq);
+    }
+    else
+    {
+        taskENTER_CRITICAL();
+        memcpy(pending, parsed, count * sizeof(mission_step));
+        pending_count = count;
+        taskEXIT_CRITICAL();
+    }
+    return count;
+}
+
+// Called by move_task on CMD_MISSION, replaces whatever mission was running
+int mission_start(void)
+{
+    taskENTER_CRITICAL();
+    memcpy(steps, pending, pending_count * sizeof(mission_step));
+    step_count = pending_count;
+    taskEXIT_CRITICAL();
+    step_next = 0;
+    running = step_count > 0;
+    completed = false;
+    mission_start_us = step_start_us = time_us_32();
+    last_step_us = 0;
+    return step_count;
+}
+
+// Next step as a command, false once the mission has run out
+bool mission_next(move_cmd *cmd)
+{
+    if (!running)
+        return false;
+    uint32_t now = time_us_32();
+    if (step_next > 0)
+        last_step_us = now - step_start_us;
+    step_start_us = now;
+    if (step_next == step_count)
+    {
+        running = false;
+        completed = true;
+        return false;
+    }
+    cmd->op = steps[step_next].op;
+    cmd->arg[0] = steps[step_next].arg;
+    cmd->arg[1] = cmd->arg[2] = 0;
+    cmd->seq = step_next;
+    cmd->timestamp_us = now;
+    ++step_next;
+    return true;
+}
+
+void mission_abort(void)
+{
+    running = false;
+    completed = false;
+}
+
+bool mission_active(void)
+{
+    return running;
+}
+
+// Progress line, sent by move_task each time a step starts and when the mission ends
+int mission_report(char *out, int len)
+{
+    if (running)
+    {
+        const mission_step *s = &steps[step_next - 1];
+        return snprintf(out, len, "[MSN]step:%d/%d\t%s:%ld\tprev:%lums\n",
+                        step_next, step_count, op_name(s->op, s->arg), s->arg, last_step_us / 1000);
+    }
+    return snprintf(out, len, "[MSN]%s:%d/%d\tprev:%lums\ttotal:%lums\n",
+                    completed ? "done" : "aborted", step_next, step_count,
+                    last_step_us / 1000, (step_start_us - mission_start_us) / 1000);
+}
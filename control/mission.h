@@ -0,0 +1,25 @@
+#ifndef mission_h
+#define mission_h
+#include "pico/stdlib.h"
+#include "command.h"
+
+// A mission is a list of movement commands uploaded in one message and run
+// back to back by move_task, each step starting in the pass the last one ended.
+// Text form, steps separated by ';' or ',':
+//   fwd<edges>  turn<+-deg>  bar[edges]  wait (for an obstacle)  clear (path clear)
+
+#define MISSION_MAX_STEPS 32
+
+typedef struct mission_step_ {
+    uint8_t op;
+    int32_t arg;
+} mission_step;
+
+int mission_load(const char *text, int len);
+int mission_start(void);
+bool mission_next(move_cmd *cmd);
+void mission_abort(void);
+bool mission_active(void);
+int mission_report(char *out, int len);
+
+#endif
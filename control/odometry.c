@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include "odometry.h"
+#include "motor.h"
+
+#define ODOM_MM_PER_EDGE Q16(ODOM_EDGE_MM)
+// heading change per edge of wheel difference, (edge / track) radians in degrees
+#define ODOM_DEG_PER_EDGE Q16(ODOM_EDGE_MM / ODOM_TRACK_MM * 57.29578)
+
+pose odom_pose;
+static int32_t last_left = 0, last_right = 0;
+static volatile bool reset_pending = true;
+
+// Take the current position as the origin. Applied by the next odom_update,
+// so it is safe to call from the command callback.
+void odom_reset(void)
+{
+    reset_pending = true;
+}
+
+q16_t odom_wrap180(q16_t deg)
+{
+    while (deg > Q16_FROM_INT(180))
+        deg -= Q16_FROM_INT(360);
+    while (deg <= -Q16_FROM_INT(180))
+        deg += Q16_FROM_INT(360);
+    return deg;
+}
+
+// Integrate the travel since the last call, run once per position loop pass
+void odom_update(void)
+{
+    int32_t left, right;
+    get_wheel_travel(&left, &right);
+    if (reset_pending)
+    {
+        reset_pending = false;
+        odom_pose.x = odom_pose.y = odom_pose.heading = 0;
+        last_left = left;
+        last_right = right;
+        return;
+    }
+    int32_t dl = left - last_left;
+    int32_t dr = right - last_right;
+    last_left = left;
+    last_right = right;
+    if (dl == 0 && dr == 0)
+        return;
+
+    q16_t turn = q16_mul_int(ODOM_DEG_PER_EDGE, dl - dr);
+    q16_t ds = q16_mul_int(ODOM_MM_PER_EDGE, dl + dr) / 2;
+    // advance along the mid-step heading
+    q16_t mid = odom_pose.heading + turn / 2;
+    odom_pose.x += q16_mul(ds, q16_cos_deg(mid));
+    odom_pose.y += q16_mul(ds, q16_sin_deg(mid));
+    odom_pose.heading += turn;
+    if (odom_pose.heading >= Q16_FROM_INT(360))
+        odom_pose.heading -= Q16_FROM_INT(360);
+    if (odom_pose.heading < 0)
+        odom_pose.heading += Q16_FROM_INT(360);
+}
+
+int odom_report(char *out, int len)
+{
+    return snprintf(out, len, "[ODO]x:%ld\ty:%ld\th:" Q16_FMT "\n",
+                    (long)q16_to_int(odom_pose.x), (long)q16_to_int(odom_pose.y), Q16_ARGS(odom_pose.heading));
+}
@@ -0,0 +1,25 @@
+#ifndef odometry_h
+#define odometry_h
+#include "fixed.h"
+
+// Dead reckoning from the signed wheel travel. The frame is fixed at the
+// last origin reset: x ahead, y to the right, heading in degrees clockwise
+// like the compass bearing so turn commands mean the same thing in both.
+
+#define ODOM_EDGE_MM 5.25  // 210mm circumference over 20 holes, both edges counted
+#define ODOM_TRACK_MM 120  // wheel centre to centre, measure for the chassis
+#define ODOM_EDGES_PER_MM Q16(1.0 / ODOM_EDGE_MM)
+
+typedef struct pose_ {
+    q16_t x, y;     // mm
+    q16_t heading;  // degrees, [0,360)
+} pose;
+
+extern pose odom_pose;
+
+void odom_reset(void);
+void odom_update(void);
+q16_t odom_wrap180(q16_t deg);
+int odom_report(char *out, int len);
+
+#endif
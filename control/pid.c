@@ -0,0 +1,44 @@
+#include "pid.h"
+#include "hotpath.h"
+
+void pid_init(pid_ctrl *pid, q16_t kp, q16_t ki, q16_t kd, int32_t out_min, int32_t out_max)
+{
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+    pid->out_min = out_min;
+    pid->out_max = out_max;
+    pid_reset(pid);
+}
+
+void pid_reset(pid_ctrl *pid)
+{
+    pid->integral = 0;
+    pid->last_error = 0;
+}
+
+// Returns feedforward + P + I + D clamped to [out_min, out_max], in output units.
+int32_t HOT(pid_update)(pid_ctrl *pid, int32_t error, int32_t feedforward)
+{
+    int32_t derivative = error - pid->last_error;
+    pid->last_error = error;
+
+    q16_t terms = q16_mul_int(pid->kp, error) + q16_mul_int(pid->kd, derivative);
+    int32_t out = feedforward + q16_to_int(terms + q16_mul_int(pid->ki, pid->integral + error));
+
+    // only integrate when that does not push further into saturation
+    if (out > pid->out_max)
+    {
+        if (error < 0)
+            pid->integral += error;
+        return pid->out_max;
+    }
+    if (out < pid->out_min)
+    {
+        if (error > 0)
+            pid->integral += error;
+        return pid->out_min;
+    }
+    pid->integral += error;
+    return out;
+}
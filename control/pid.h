@@ -0,0 +1,17 @@
+#ifndef pid_h
+#define pid_h
+#include "fixed.h"
+
+// Q16.16 PID with output clamping and conditional integration anti-windup.
+typedef struct pid_ctrl_ {
+    q16_t kp, ki, kd;
+    int32_t out_min, out_max;
+    int32_t integral;
+    int32_t last_error;
+} pid_ctrl;
+
+void pid_init(pid_ctrl *pid, q16_t kp, q16_t ki, q16_t kd, int32_t out_min, int32_t out_max);
+void pid_reset(pid_ctrl *pid);
+int32_t pid_update(pid_ctrl *pid, int32_t error, int32_t feedforward);
+
+#endif
@@ -0,0 +1,80 @@
+#include "profile.h"
+
+void profile_start(motion_profile *p, int32_t distance, int32_t vmax, int32_t amax, uint32_t hz)
+{
+    p->dir = distance < 0 ? -1 : 1;
+    p->target = Q16_FROM_INT(distance < 0 ? -distance : distance);
+    p->pos = 0;
+    p->vel = 0;
+    p->vmax = Q16_FROM_INT(vmax);
+    p->amax = Q16_FROM_INT(amax);
+    if (hz == 0) // a loop rate below the outer divider, treat it as 1Hz rather than divide by 0
+        hz = 1;
+    p->dt = (Q16_ONE + hz / 2) / hz;
+    p->done = p->target == 0;
+}
+
+static q16_t stopping_distance(const motion_profile *p)
+{
+    return (q16_t)(((int64_t)p->vel * p->vel) / (2 * (int64_t)p->amax));
+}
+
+// Brake at amax from the current setpoint, e.g. for an obstacle or a cancel.
+void profile_stop(motion_profile *p)
+{
+    if (p->done)
+        return;
+    p->target = p->pos + stopping_distance(p);
+}
+
+// Advance one period. Accelerates towards vmax until the remaining distance
+// equals the braking distance, then decelerates so the move ends on target
+// with zero velocity. Returns true once the move is finished.
+bool profile_step(motion_profile *p)
+{
+    if (p->done)
+        return true;
+
+    q16_t dv = q16_mul(p->amax, p->dt);
+    q16_t remaining = p->target - p->pos;
+    if (remaining <= stopping_distance(p) + q16_mul(p->vel, p->dt))
+    {
+        p->vel -= dv;
+        if (p->vel < dv)
+            p->vel = dv; // creep the last bit instead of stalling short of target
+    }
+    else if (p->vel < p->vmax)
+    {
+        p->vel = p->vel + dv > p->vmax ? p->vmax : p->vel + dv;
+    }
+
+    p->pos += q16_mul(p->vel, p->dt);
+    if (p->pos >= p->target)
+    {
+        p->pos = p->target;
+        p->vel = 0;
+        p->done = true;
+    }
+    return p->done;
+}
+
+int32_t profile_position(const motion_profile *p)
+{
+    return p->dir * q16_to_int(p->pos);
+}
+
+int32_t profile_velocity(const motion_profile *p)
+{
+    return p->dir * q16_to_int(p->vel);
+}
+
+int32_t profile_remaining(const motion_profile *p)
+{
+    return q16_to_int(p->target - p->pos);
+}
+
+// Where the move will finish, changes after profile_stop.
+int32_t profile_end(const motion_profile *p)
+{
+    return p->dir * q16_to_int(p->target);
+}
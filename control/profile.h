@@ -0,0 +1,25 @@
+#ifndef profile_h
+#define profile_h
+#include "fixed.h"
+
+// Trapezoidal motion profile, stepped once per control period.
+// Units are whatever the caller uses (encoder edges, degrees), rates are per second.
+typedef struct motion_profile_ {
+    q16_t target; // distance to cover, always positive
+    q16_t pos;    // setpoint position along the move
+    q16_t vel;    // setpoint velocity
+    q16_t vmax, amax;
+    q16_t dt;     // control period in seconds
+    int8_t dir;
+    bool done;
+} motion_profile;
+
+void profile_start(motion_profile *p, int32_t distance, int32_t vmax, int32_t amax, uint32_t hz);
+void profile_stop(motion_profile *p);
+bool profile_step(motion_profile *p);
+int32_t profile_position(const motion_profile *p);
+int32_t profile_velocity(const motion_profile *p);
+int32_t profile_remaining(const motion_profile *p);
+int32_t profile_end(const motion_profile *p);
+
+#endif
@@ -4,15 +4,16 @@
 #include <stdio.h>
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
+#include "hotpath.h"
 
 int timeout = 26100;
 
 volatile absolute_time_t startTime;
 volatile absolute_time_t endTime;
-volatile uint64_t pulseLength;
+volatile uint32_t pulseLength; // capped by timeout, 32 bit keeps the scaling off the 64 bit divide
 volatile bool echo_received;
 
-void echocallback(uint32_t events)
+void HOT(echocallback)(uint gpio, uint32_t events, void *ctx)
 {
     if (events == GPIO_IRQ_EDGE_RISE)
     {
@@ -45,8 +46,8 @@ void setup_ultrasonic_pins(uint trigPin, uint echoPin)
 
 }
 
-double getcm(uint trigPin, uint echoPin)
+uint32_t getcm(uint trigPin, uint echoPin)
 {
     sendpulse(trigPin, echoPin);
-    return pulseLength / 29 / 2;
+    return pulseLength / 58; // 29us per cm, there and back
 }
@@ -1,6 +1,7 @@
 #ifndef ultrasonic_h
 #define ultrasonic_h
-void echocallback(uint32_t events);
-void setup_ultrasonic_pins(int trigPin, int echoPin);
-double getcm(int trigPin, int echoPin);
+#include "pico/stdlib.h"
+void echocallback(uint gpio, uint32_t events, void *ctx);
+void setup_ultrasonic_pins(uint trigPin, uint echoPin);
+uint32_t getcm(uint trigPin, uint echoPin);
 #endif
\ No newline at end of file
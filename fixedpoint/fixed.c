@@ -0,0 +1,122 @@
+#include "fixed.h"
+
+// Parse a decimal string such as "1.50" or "-0.3" into Q16.16 without atof.
+q16_t q16_parse(const char *s, int maxlen)
+{
+    int i = 0;
+    bool negative = false;
+    int32_t whole = 0;
+    int32_t frac = 0;
+    int32_t frac_div = 1;
+
+    if (i < maxlen && (s[i] == '-' || s[i] == '+'))
+        negative = s[i++] == '-';
+    for (; i < maxlen && s[i] >= '0' && s[i] <= '9'; ++i)
+        whole = whole * 10 + (s[i] - '0');
+    if (i < maxlen && s[i] == '.')
+    {
+        for (++i; i < maxlen && s[i] >= '0' && s[i] <= '9' && frac_div < 100000; ++i)
+        {
+            frac = frac * 10 + (s[i] - '0');
+            frac_div *= 10;
+        }
+    }
+    q16_t result = Q16_FROM_INT(whole) + (q16_t)((((int64_t)frac << Q16_SHIFT) + frac_div / 2) / frac_div);
+    return negative ? -result : result;
+}
+
+// atan(z) for z in [0,1], returned in Q16.16 degrees.
+// atan(z) ~= 45z + 15.64z(1-z), max error about 0.22 degrees.
+static q16_t q16_atan_unit_deg(q16_t z)
+{
+    return 45 * z + q16_mul(Q16(15.64), q16_mul(z, Q16_ONE - z));
+}
+
+// Integer atan2 returning degrees in Q16.16, range (-180, 180].
+q16_t q16_atan2_deg(int64_t y, int64_t x)
+{
+    if (x == 0 && y == 0)
+        return 0;
+    uint64_t ax = x < 0 ? -x : x;
+    uint64_t ay = y < 0 ? -y : y;
+    // bring both into 15 bits so the division below stays 32 bit (hardware divider)
+    while ((ax | ay) >= (1u << 15))
+    {
+        ax >>= 1;
+        ay >>= 1;
+    }
+
+    q16_t angle;
+    if (ay <= ax)
+        angle = q16_atan_unit_deg((q16_t)(((uint32_t)ay << Q16_SHIFT) / (uint32_t)ax));
+    else
+        angle = Q16_FROM_INT(90) - q16_atan_unit_deg((q16_t)(((uint32_t)ax << Q16_SHIFT) / (uint32_t)ay));
+
+    if (x < 0)
+        angle = Q16_FROM_INT(180) - angle;
+    return y < 0 ? -angle : angle;
+}
+
+// Bhaskara's approximation, sin(x) ~= 4x(180-x) / (40500 - x(180-x)) for x in
+// [0,180] degrees, max error about 0.0016. deg is Q16.16, any range.
+q16_t q16_sin_deg(q16_t deg)
+{
+    int64_t x = deg % Q16_FROM_INT(360);
+    if (x < 0)
+        x += Q16_FROM_INT(360);
+    bool negative = x > Q16_FROM_INT(180);
+    if (negative)
+        x -= Q16_FROM_INT(180);
+    int64_t p = (x * (Q16_FROM_INT(180) - x)) >> Q16_SHIFT;
+    q16_t s = (q16_t)((4 * p << Q16_SHIFT) / ((int64_t)40500 * Q16_ONE - p));
+    return negative ? -s : s;
+}
+
+q16_t q16_cos_deg(q16_t deg)
+{
+    return q16_sin_deg(deg + Q16_FROM_INT(90));
+}
+
+uint32_t isqrt32(uint32_t x)
+{
+    uint32_t result = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > x)
+        bit >>= 2;
+    while (bit)
+    {
+        if (x >= result + bit)
+        {
+            x -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return result;
+}
+
+uint32_t isqrt64(uint64_t x)
+{
+    uint64_t result = 0;
+    uint64_t bit = 1ull << 62;
+    while (bit > x)
+        bit >>= 2;
+    while (bit)
+    {
+        if (x >= result + bit)
+        {
+            x -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)result;
+}
@@ -0,0 +1,81 @@
+#ifndef fixed_h
+#define fixed_h
+#include <stdint.h>
+#include <stdbool.h>
+
+// Fixed point helpers for the control path.
+// The RP2040 (Cortex-M0+) has no FPU, so every float/double operation is a
+// call into the soft-float library. Q16.16 keeps everything in the integer
+// ALU: add/sub are free, mul is one 32x32->64 multiply and a shift.
+
+#define Q16_SHIFT 16
+#define Q16_ONE (1 << Q16_SHIFT)
+
+typedef int32_t q16_t; // Q16.16, range +-32767.99998, step 1/65536
+
+// Only use with compile time constants, the float math is folded away.
+#define Q16(x) ((q16_t)((x) * (double)Q16_ONE + ((x) >= 0 ? 0.5 : -0.5)))
+#define Q16_FROM_INT(x) ((q16_t)((x) * Q16_ONE))
+
+// printf helpers, e.g. printf("ctrl:" Q16_FMT, Q16_ARGS(control));
+#define Q16_FMT "%s%ld.%03ld"
+#define Q16_ARGS(x) ((x) < 0 ? "-" : ""), (long)(q16_abs(x) >> Q16_SHIFT), (long)(((q16_abs(x) & (Q16_ONE - 1)) * 1000) >> Q16_SHIFT)
+
+static inline q16_t q16_abs(q16_t a)
+{
+    return a < 0 ? -a : a;
+}
+
+static inline q16_t q16_mul(q16_t a, q16_t b)
+{
+    return (q16_t)(((int64_t)a * b) >> Q16_SHIFT);
+}
+
+// gain * integer error, result stays in Q16.16. Saturates instead of wrapping.
+static inline q16_t q16_mul_int(q16_t a, int32_t b)
+{
+    int64_t r = (int64_t)a * b;
+    if (r > INT32_MAX)
+        return INT32_MAX;
+    if (r < INT32_MIN)
+        return INT32_MIN;
+    return (q16_t)r;
+}
+
+static inline q16_t q16_div_int(q16_t a, int32_t b)
+{
+    return a / b;
+}
+
+static inline q16_t q16_clamp(q16_t a, q16_t lo, q16_t hi)
+{
+    if (a < lo)
+        return lo;
+    if (a > hi)
+        return hi;
+    return a;
+}
+
+// Round to nearest integer.
+static inline int32_t q16_to_int(q16_t a)
+{
+    return (a + (Q16_ONE / 2)) >> Q16_SHIFT;
+}
+
+// Scale an integer by a Q16.16 fraction, e.g. duty cycle from a 0..1 control output.
+// Only valid while |a * n| < 2^31, which holds for control in [0,1] and n <= 32767.
+static inline int32_t q16_scale(q16_t a, int32_t n)
+{
+    return (a * n) >> Q16_SHIFT;
+}
+
+q16_t q16_parse(const char *s, int maxlen);
+q16_t q16_atan2_deg(int64_t y, int64_t x);
+q16_t q16_sin_deg(q16_t deg);
+q16_t q16_cos_deg(q16_t deg);
+uint32_t isqrt32(uint32_t x);
+uint32_t isqrt64(uint64_t x);
+
+void fixed_benchmark(char *out, int len);
+
+#endif
@@ -0,0 +1,62 @@
+// Cycle count comparison of the move_task control step in soft-float vs Q16.16.
+// Triggered with the "bench" command, run it while the car is paused.
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "fixed.h"
+
+#define BENCH_ITERATIONS 1000
+#define BENCH_SPEED 6250
+
+static volatile int32_t bench_error = 120;
+static volatile int32_t bench_last_error = 123;
+
+static uint16_t __attribute__((noinline)) control_step_float(float kp, float kd, int32_t error, int32_t last_error)
+{
+    float derivative = error - last_error;
+    float control = kp * error + kd * derivative;
+    if (control > 1)
+        control = 1;
+    if (control < 0)
+        control = 0;
+    return control * (BENCH_SPEED);
+}
+
+static uint16_t __attribute__((noinline)) control_step_fixed(q16_t kp, q16_t kd, int32_t error, int32_t last_error)
+{
+    int32_t derivative = error - last_error;
+    q16_t control = q16_mul_int(kp, error) + q16_mul_int(kd, derivative);
+    control = q16_clamp(control, 0, Q16_ONE);
+    return q16_scale(control, BENCH_SPEED);
+}
+
+// Cortex-M0+ has no cycle counter, so time a batch with the 1MHz timer and scale by clk_sys.
+static uint32_t cycles_per_call(uint64_t elapsed_us)
+{
+    return (uint32_t)(elapsed_us * (clock_get_hz(clk_sys) / 1000000) / BENCH_ITERATIONS);
+}
+
+void fixed_benchmark(char *out, int len)
+{
+    volatile uint32_t sink = 0;
+    float fkp = 0.15f, fkd = 0.075f;
+    q16_t qkp = Q16(0.15), qkd = Q16(0.075);
+
+    uint64_t start = time_us_64();
+    for (int i = 0; i < BENCH_ITERATIONS; ++i)
+        sink += control_step_float(fkp, fkd, bench_error + (i & 7), bench_last_error);
+    uint32_t float_cycles = cycles_per_call(time_us_64() - start);
+
+    start = time_us_64();
+    for (int i = 0; i < BENCH_ITERATIONS; ++i)
+        sink += control_step_fixed(qkp, qkd, bench_error + (i & 7), bench_last_error);
+    uint32_t fixed_cycles = cycles_per_call(time_us_64() - start);
+
+    start = time_us_64();
+    for (int i = 0; i < BENCH_ITERATIONS; ++i)
+        sink += q16_atan2_deg(bench_error + i, bench_last_error - i);
+    uint32_t atan_cycles = cycles_per_call(time_us_64() - start);
+
+    snprintf(out, len, "[BENCH]float:%lu\tfixed:%lu\tatan2:%lu cycles/call\n", float_cycles, fixed_cycles, atan_cycles);
+}
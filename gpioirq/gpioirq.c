@@ -0,0 +1,76 @@
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/structs/iobank0.h"
+#include "trace.h"
+#include "isrstats.h"
+#include "hotpath.h"
+#include "gpioirq.h"
+
+#define GPIOIRQ_REGS 4 // 8 pins of 4 event bits per status register
+
+typedef struct gpioirq_entry_ {
+    gpioirq_handler handler;
+    void *ctx;
+} gpioirq_entry;
+
+static gpioirq_entry table[GPIOIRQ_PINS];
+static uint32_t owned[GPIOIRQ_REGS]; // event bits of the registered pins, in status register layout
+
+// Every pending registered pin in one pass, lowest pin first like the SDK
+static void HOT(gpioirq_dispatch)(void)
+{
+    io_irq_ctrl_hw_t *ctrl = &iobank0_hw->proc0_irq_ctrl;
+    for (uint reg = 0; reg < GPIOIRQ_REGS; ++reg)
+    {
+        uint32_t pending = ctrl->ints[reg] & owned[reg];
+        if (pending == 0)
+            continue;
+        iobank0_hw->intr[reg] = pending; // acknowledge the edges, level events clear themselves
+        while (pending)
+        {
+            uint shift = __builtin_ctz(pending) & ~3u;
+            uint gpio = reg * 8 + shift / 4;
+            uint32_t events = (pending >> shift) & 0xfu;
+            pending &= ~(0xfu << shift);
+            uint32_t entry = isrstats_enter();
+            trace_event(TRACE_IRQ_ENTER, gpio, events);
+            table[gpio].handler(gpio, events, table[gpio].ctx);
+            trace_event(TRACE_IRQ_EXIT, gpio, 0);
+            isrstats_exit(gpio, entry);
+        }
+    }
+}
+
+void gpioirq_init(void)
+{
+    irq_add_shared_handler(IO_IRQ_BANK0, gpioirq_dispatch, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+
+// Route events on gpio to handler and enable them. False if the pin is out
+// of range or already has a handler.
+bool gpioirq_register(uint gpio, uint32_t events, gpioirq_handler handler, void *ctx)
+{
+    if (gpio >= GPIOIRQ_PINS || handler == NULL || table[gpio].handler != NULL)
+        return false;
+    uint32_t irq = save_and_disable_interrupts();
+    table[gpio].handler = handler;
+    table[gpio].ctx = ctx;
+    owned[gpio / 8] |= (events & 0xfu) << (4 * (gpio % 8));
+    restore_interrupts(irq);
+    gpio_set_irq_enabled(gpio, events, true);
+    return true;
+}
+
+void gpioirq_unregister(uint gpio)
+{
+    if (gpio >= GPIOIRQ_PINS || table[gpio].handler == NULL)
+        return;
+    gpio_set_irq_enabled(gpio, 0xfu, false);
+    uint32_t irq = save_and_disable_interrupts();
+    owned[gpio / 8] &= ~(0xfu << (4 * (gpio % 8)));
+    table[gpio].handler = NULL;
+    table[gpio].ctx = NULL;
+    restore_interrupts(irq);
+}
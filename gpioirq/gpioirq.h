@@ -0,0 +1,23 @@
+#ifndef gpioirq_h
+#define gpioirq_h
+#include "pico/stdlib.h"
+
+// GPIO interrupt dispatch through a table indexed by pin. One IO_IRQ_BANK0
+// handler, in SRAM (hotpath.h), reads the pending status of the registered pins only and
+// calls each pin's handler directly, no compare chain and no scan of the 30
+// pins like the SDK's gpio_set_irq_callback. Pins nobody registered never
+// get their interrupt enabled, and pins owned by others (the CYW43 host wake)
+// are left to their own raw handlers.
+//   gpioirq_register(ECHO_PIN, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, echocallback, NULL);
+// Handlers run in the interrupt, events is the GPIO_IRQ_ bits that fired.
+// Register and unregister from core 0, the one the handler runs on.
+
+#define GPIOIRQ_PINS 30
+
+typedef void (*gpioirq_handler)(uint gpio, uint32_t events, void *ctx);
+
+void gpioirq_init(void);
+bool gpioirq_register(uint gpio, uint32_t events, gpioirq_handler handler, void *ctx);
+void gpioirq_unregister(uint gpio);
+
+#endif
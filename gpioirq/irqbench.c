@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include "hardware/sync.h"
+#include "hardware/structs/iobank0.h"
+#include "hardware/structs/systick.h"
+#include "hardware/structs/xip_ctrl.h"
+#include "gpioirq.h"
+#include "hotpath.h"
+#include "irqbench.h"
+
+static volatile uint32_t entry_cvr;
+static volatile bool fired;
+
+static inline uint32_t force_bit(void)
+{
+    return GPIO_IRQ_EDGE_RISE << (4 * (IRQBENCH_PIN % 8));
+}
+
+// placed like the real handlers, so it moves with BLINKY_HOT_IN_RAM
+static void HOT(bench_handler)(uint gpio, uint32_t events, void *ctx)
+{
+    entry_cvr = systick_hw->cvr;
+    hw_clear_bits(&iobank0_hw->proc0_irq_ctrl.intf[IRQBENCH_PIN / 8], force_bit());
+    fired = true;
+}
+
+void irqbench_init(void)
+{
+    // driven low, so only the forced interrupt ever fires
+    gpio_init(IRQBENCH_PIN);
+    gpio_set_dir(IRQBENCH_PIN, GPIO_OUT);
+    gpio_put(IRQBENCH_PIN, 0);
+    gpioirq_register(IRQBENCH_PIN, GPIO_IRQ_EDGE_RISE, bench_handler, NULL);
+}
+
+static uint hist_bin(uint32_t cycles)
+{
+    uint bin = cycles ? 32 - __builtin_clz(cycles) : 0;
+    return bin < IRQBENCH_BINS ? bin : IRQBENCH_BINS - 1;
+}
+
+// One sample, always in SRAM so a cold cache only slows the interrupt path.
+// Returns the cycles from the force to the handler, or UINT32_MAX if it never ran.
+static uint32_t __not_in_flash_func(measure)(bool cold)
+{
+    fired = false;
+    if (cold)
+    {
+        xip_ctrl_hw->flush = 1;
+        (void)xip_ctrl_hw->flush; // the read stalls until the flush is done
+    }
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t start = systick_hw->cvr;
+    hw_set_bits(&iobank0_hw->proc0_irq_ctrl.intf[IRQBENCH_PIN / 8], force_bit());
+    restore_interrupts(irq);
+    for (int spin = 0; !fired; ++spin)
+        if (spin > 100000)
+            return UINT32_MAX;
+    // SysTick counts down and reloads every FreeRTOS tick
+    uint32_t end = entry_cvr;
+    return end <= start ? start - end : start + systick_hw->rvr + 1 - end;
+}
+
+void irqbench_run(irqbench_result *r, bool cold)
+{
+    memset(r, 0, sizeof(*r));
+    r->cold = cold;
+    r->min = UINT32_MAX;
+    for (int i = 0; i < IRQBENCH_SAMPLES; ++i)
+    {
+        uint32_t cycles = measure(cold);
+        if (cycles == UINT32_MAX)
+        {
+            ++r->timeouts;
+            continue;
+        }
+        ++r->n;
+        r->sum += cycles;
+        ++r->hist[hist_bin(cycles)];
+        if (cycles < r->min)
+            r->min = cycles;
+        if (cycles > r->max)
+            r->max = cycles;
+        sleep_us(50); // let the other interrupts and the cache settle between samples
+    }
+}
+
+static const char *build_name(void)
+{
+#if PICO_COPY_TO_RAM
+    return "copy_to_ram";
+#elif HOTPATH_IN_RAM
+    return "hot_in_ram";
+#else
+    return "flash";
+#endif
+}
+
+// Two lines, summary and histogram. Returns 0 past the last line.
+int irqbench_report(const irqbench_result *r, char *out, int len, int line)
+{
+    if (line == 0)
+        return snprintf(out, len, "[IRB]build:%s\tcold:%d\tn:%lu\tto:%lu\tmin:%lu\tmean:%lu\tmax:%lu\n",
+                        build_name(), r->cold, r->n, r->timeouts, r->n ? r->min : 0,
+                        r->n ? (uint32_t)(r->sum / r->n) : 0, r->max);
+    if (line != 1)
+        return 0;
+    int n = snprintf(out, len, "[IRB]%s", r->cold ? "cold" : "warm");
+    for (int i = 0; i < IRQBENCH_BINS && n < len; ++i)
+        n += snprintf(out + n, len - n, ":%lu", r->hist[i]);
+    if (n < len)
+        n += snprintf(out + n, len - n, "\n");
+    return n;
+}
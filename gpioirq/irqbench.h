@@ -0,0 +1,29 @@
+#ifndef irqbench_h
+#define irqbench_h
+#include "pico/stdlib.h"
+
+// GPIO interrupt entry latency, for comparing hot paths in flash and in SRAM
+// (hotpath.h). A spare pin's interrupt is forced in software and the time from
+// the force to its handler, through the vector, isrstats and gpioirq
+// dispatch, is measured in CPU cycles on SysTick. Cold runs flush the XIP
+// cache before each force, the state after CYW43 and lwIP code evicted it.
+// Run from a task, the interrupt must be able to preempt the caller.
+
+#define IRQBENCH_PIN 22     // not wired to anything
+#define IRQBENCH_SAMPLES 500
+#define IRQBENCH_BINS 12    // bin 0 is 0 cycles, bin n is [2^(n-1), 2^n) cycles, last bin catches the rest
+
+typedef struct irqbench_result_ {
+    bool cold;
+    uint32_t n;
+    uint32_t timeouts;
+    uint32_t min, max;
+    uint64_t sum;
+    uint32_t hist[IRQBENCH_BINS];
+} irqbench_result;
+
+void irqbench_init(void);
+void irqbench_run(irqbench_result *r, bool cold);
+int irqbench_report(const irqbench_result *r, char *out, int len, int line);
+
+#endif
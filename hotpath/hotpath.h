@@ -0,0 +1,22 @@
+#ifndef hotpath_h
+#define hotpath_h
+#include "pico/platform.h"
+
+// Code on the interrupt and control loop paths. With HOTPATH_IN_RAM (cmake
+// -DBLINKY_HOT_IN_RAM=ON, the default) the crt0 copies it to SRAM with
+// .data, so a flash cache miss after CYW43 and lwIP ran can't stretch an
+// edge. OFF leaves it in flash, for comparing the two with "bench 1".
+//   void HOT(drive_update)(void)
+// HOT_DATA goes on the const tables that code reads, they stay in flash otherwise.
+// The SDK and FreeRTOS functions they call stay in flash either way, unless
+// the whole image is built copy_to_ram (-DBLINKY_COPY_TO_RAM=ON).
+
+#if HOTPATH_IN_RAM
+#define HOT(fn) __not_in_flash_func(fn)
+#define HOT_DATA __not_in_flash("hot_data")
+#else
+#define HOT(fn) fn
+#define HOT_DATA
+#endif
+
+#endif
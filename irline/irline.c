@@ -1,8 +1,9 @@
 #include "irline.h"
 #include "server.h"
+#include "logging.h"
 
 // MessageBufferHandle_t barcodeMsgBuffer;
-static const unsigned char bit_reverse_table256[] = 
+static const unsigned char bit_reverse_table256[] HOT_DATA = 
 {
   0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0, 0x30, 0xB0, 0x70, 0xF0, 
   0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8, 0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8, 
@@ -29,7 +30,7 @@ long long get_time_ms(void) {
     return (((long long)timevalue.tv_sec)*1000)+(timevalue.tv_sec/1000);
 }
 
-char read_char(char bars, char spaces){
+char HOT(read_char)(char bars, char spaces){
     static char CODE39ENCODE[] = "~1234567890ABCDEFGHIJKLMNOPQRSTUVWXYZ-. *";
     char bar_num = 0, space_num = 1;
     switch (bars)
@@ -84,12 +85,12 @@ char read_char(char bars, char spaces){
     default:
         break;
     }
-    printf("[barcode] bars is %d, spaces is %d\n", bars, spaces);
-    printf("[barcode] bar_num is %d, space_num is %d\n", bar_num, space_num);
+    LOG("[barcode] bars is %d, spaces is %d\n", bars, spaces);
+    LOG("[barcode] bar_num is %d, space_num is %d\n", bar_num, space_num);
     if (bar_num == 0 || space_num == 1) return '%';
     return CODE39ENCODE[bar_num + space_num];
 }
-char read_char_reversed(char bars, char spaces){
+char HOT(read_char_reversed)(char bars, char spaces){
     return read_char(bit_reverse_table256[bars] >> 3, bit_reverse_table256[spaces] >> 4);
 }
 
@@ -98,7 +99,7 @@ char read_char_reversed(char bars, char spaces){
 
 char randomtext[100] = "";
 char placeholdertext[100] = "\n";
-void barcode_handler(uint32_t events)
+void HOT(barcode_handler)(uint gpio, uint32_t events, void *ctx)
 {
     static volatile int counter = 0;
     static volatile absolute_time_t prev_time = {};
@@ -143,7 +144,7 @@ void barcode_handler(uint32_t events)
                     data[datacount++] = '*';
                 } else{
                     sprintf(randomtext,"[barcode] barcode does not start with '*'\n");
-                    xMessageBufferSendFromISR(wifiMsgBufferFromISR, &randomtext, sizeof(randomtext), NULL);
+                    server_publish(SERVER_STREAM_BARCODE, randomtext, strlen(randomtext) + 1);
                 }
             }else{
                 if (reversed)
@@ -152,13 +153,13 @@ void barcode_handler(uint32_t events)
                     data[datacount] = read_char(info[BAR], info[SPACE]);
                 if (data[datacount++] == '*'){
                     datacount = 0;
-                    xMessageBufferSendFromISR(wifiMsgBufferFromISR, &data, sizeof(data), NULL);
+                    server_publish(SERVER_STREAM_BARCODE, data, sizeof(data));
                     memset(&data, 0, sizeof(data));
                     reversed = false;
                 }
             }
-            xMessageBufferSendFromISR(wifiMsgBufferFromISR, &data, sizeof(data), NULL);
-            xMessageBufferSendFromISR(wifiMsgBufferFromISR, &placeholdertext, sizeof(1), NULL);
+            server_publish(SERVER_STREAM_BARCODE, data, sizeof(data));
+            server_publish(SERVER_STREAM_BARCODE, placeholdertext, sizeof(1));
             // xMessageBufferSendFromISR(barcodeMsgBuffer, info, sizeof(info), 0);
             counter = 0;
             info[BAR] = 0;
@@ -167,57 +168,6 @@ void barcode_handler(uint32_t events)
     }
 }
 
-bool is_barcode(absolute_time_t start, absolute_time_t end) {
-    uint64_t time_elapse = absolute_time_diff_us(start, end) / 1000;
-    if (time_elapse < 400) {
-        return true;
-    }
-    return false;
-}
-
-static volatile bool left = false;
-static volatile bool right = false;
-
-void wall_detect_handler(uint16_t gpio, uint32_t events) {
-    if (gpio == 26) {
-        static volatile absolute_time_t leftHit = {};
-        if (events == GPIO_IRQ_EDGE_RISE) {
-            left = true;
-            leftHit = get_absolute_time();
-        } else {
-            if (!right) {
-                left_tilt();
-                return;
-            }
-            left=false;
-            absolute_time_t left_now_time = get_absolute_time();
-            if (!is_barcode(leftHit, left_now_time)) {
-                stop();
-                return;
-            }
-            stop();
-        }
-    } else {
-        static volatile absolute_time_t rightHit = {};
-        if (events == GPIO_IRQ_EDGE_RISE) {
-            right = true;
-            rightHit = get_absolute_time();
-        } else {
-            if (!left) {
-                right_tilt();
-                return;
-            }
-            right = false;
-            absolute_time_t right_now_time = get_absolute_time();
-            if (!is_barcode(rightHit, right_now_time)) {
-                stop();
-                return;
-            }
-            stop();
-        }
-    }
-}
-
 char convert_bit_array_to_uint8(bool arr[], int count){
     // taken from https://stackoverflow.com/questions/32410186/convert-bool-array-to-int32-unsigned-int-and-double
     char ret = 0;
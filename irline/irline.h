@@ -8,6 +8,7 @@
 #include "motor.h"
 #include "FreeRTOS.h"  // Include the FreeRTOS library for real-time operating system functionality.
 #include "message_buffer.h"
+#include "hotpath.h"
 
 #define ADC_PIN 15
 
@@ -19,12 +20,11 @@
 #define BARCODE_BARCOUNT 5
 #define BARCODE_SPACECOUNT 4
 
-const static char SPACE_BIT_VALUE[] = {8, 4, 2, 1};
-const static char BAR_BIT_VALUE[] = {16, 8, 4, 2, 1};
+const static char SPACE_BIT_VALUE[] HOT_DATA = {8, 4, 2, 1};
+const static char BAR_BIT_VALUE[] HOT_DATA = {16, 8, 4, 2, 1};
 
 extern MessageBufferHandle_t barcodeMsgBuffer;
-void barcode_handler(uint32_t events);
+void barcode_handler(uint gpio, uint32_t events, void *ctx);
 void init_adc();
-void wall_detect_handler(uint16_t gpio, uint32_t events);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include "hardware/sync.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "logging.h"
+
+#define LOG_POLL_MS 20 // LogTask drains the ring this often, writers never wake it
+
+// Any number of writers (tasks, ISRs) and LogTask as the only reader. Writers
+// fill the record with interrupts off, so it is complete once head moves past it.
+static log_record ring[LOG_RING];
+static volatile uint32_t head = 0, tail = 0;
+static log_stats stats;
+static void (*log_sink)(const char *line) = NULL;
+
+void log_write(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5)
+{
+    uint32_t t = time_us_32();
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t used = head - tail;
+    if (used < LOG_RING)
+    {
+        log_record *r = &ring[head & (LOG_RING - 1)];
+        r->t_us = t;
+        r->fmt = fmt;
+        r->arg[0] = a0;
+        r->arg[1] = a1;
+        r->arg[2] = a2;
+        r->arg[3] = a3;
+        r->arg[4] = a4;
+        r->arg[5] = a5;
+        ++head;
+        ++stats.written;
+        if (used + 1 > stats.high_water)
+            stats.high_water = used + 1;
+    }
+    else
+    {
+        ++stats.dropped;
+    }
+    restore_interrupts(irq);
+}
+
+// Also hand every formatted line to sink, e.g. to send it to the TCP clients
+void log_set_sink(void (*sink)(const char *line))
+{
+    log_sink = sink;
+}
+
+void log_task(__unused void *params)
+{
+    char line[128];
+    uint32_t reported_drops = 0;
+    while (1)
+    {
+        while (tail != head)
+        {
+            log_record r = ring[tail & (LOG_RING - 1)];
+            ++tail;
+            int n = snprintf(line, sizeof(line), "%lu.%03lu ", r.t_us / 1000, r.t_us % 1000);
+            snprintf(line + n, sizeof(line) - n, r.fmt, r.arg[0], r.arg[1], r.arg[2], r.arg[3], r.arg[4], r.arg[5]);
+            fputs(line, stdout);
+            if (log_sink)
+                log_sink(line);
+        }
+        if (stats.dropped != reported_drops)
+        {
+            printf("log: dropped %lu records\n", stats.dropped - reported_drops);
+            reported_drops = stats.dropped;
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_POLL_MS));
+    }
+}
+
+int log_report(char *out, int len)
+{
+    return snprintf(out, len, "[LOG]written:%lu\tdropped:%lu\thw:%lu/%d\n",
+                    stats.written, stats.dropped, stats.high_water, LOG_RING);
+}
@@ -0,0 +1,47 @@
+#ifndef logging_h
+#define logging_h
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+// Deferred format logging. LOG() stores the format string's address and up to
+// LOG_MAX_ARGS 32 bit arguments in a RAM ring, LogTask runs printf on them
+// later at low priority. Safe from ISRs and lwIP callbacks, a record costs
+// a few dozen cycles with interrupts off for the copy.
+//   LOG("turn %ld\n", angle);
+// The format must be a string literal and %s arguments must point at strings
+// that outlive the record (literals). No 64 bit or floating point arguments,
+// cast long long counts to long. A full ring drops the record and counts it.
+
+#define LOG_MAX_ARGS 6
+#define LOG_RING 128 // records, power of two
+
+typedef struct log_record_ {
+    uint32_t t_us;
+    const char *fmt;
+    uint32_t arg[LOG_MAX_ARGS];
+} log_record;
+
+typedef struct log_stats_ {
+    uint32_t written;
+    uint32_t dropped;
+    uint32_t high_water;
+} log_stats;
+
+void log_write(const char *fmt, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3, uint32_t a4, uint32_t a5);
+void log_set_sink(void (*sink)(const char *line));
+void log_task(__unused void *params);
+int log_report(char *out, int len);
+
+#define LOG_ARGS_(fmt, a, b, c, d, e, f, ...)                                                          \
+    log_write(fmt, (uint32_t)(uintptr_t)(a), (uint32_t)(uintptr_t)(b), (uint32_t)(uintptr_t)(c),      \
+              (uint32_t)(uintptr_t)(d), (uint32_t)(uintptr_t)(e), (uint32_t)(uintptr_t)(f))
+// the dead printf lets the compiler check the arguments against the format
+#define LOG(...)                                       \
+    do                                                 \
+    {                                                  \
+        if (0)                                         \
+            printf(__VA_ARGS__);                       \
+        LOG_ARGS_(__VA_ARGS__, 0, 0, 0, 0, 0, 0, 0);   \
+    } while (0)
+
+#endif
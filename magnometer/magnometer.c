@@ -3,6 +3,7 @@
 #include <stdio.h>                   // Include the standard I/O library.
 #include <math.h>                   // Include the math library.
 #include "magnometer.h"
+#include "fixed.h"
 
 #define I2C_PORT i2c0                 // Define the I2C port to be used.
 
@@ -33,34 +34,19 @@
 
 vector_i m_min = {-463, -620, -621};
 vector_i m_max = {516, 273, 4};
-vector_f from = {1, 0, 0};
-
-void vector_cross(vector_i *a, const vector_i *b, vector_f *out)
+void vector_cross(const vector_i *a, const vector_i *b, vector_l *out)
 {
-  out->x = (a->y * b->z) - (a->z * b->y);
-  out->y = (a->z * b->x) - (a->x * b->z);
-  out->z = (a->x * b->y) - (a->y * b->x);
+  out->x = ((int64_t)a->y * b->z) - ((int64_t)a->z * b->y);
+  out->y = ((int64_t)a->z * b->x) - ((int64_t)a->x * b->z);
+  out->z = ((int64_t)a->x * b->y) - ((int64_t)a->y * b->x);
 }
-void vector_cross2(vector_i *a, const vector_f *b, vector_f *out)
+void vector_cross2(const vector_i *a, const vector_l *b, vector_l *out)
 {
   out->x = (a->y * b->z) - (a->z * b->y);
   out->y = (a->z * b->x) - (a->x * b->z);
   out->z = (a->x * b->y) - (a->y * b->x);
 }
 
-float vector_dot(vector_f *a, vector_f *b)
-{
-  return (a->x * b->x) + (a->y * b->y) + (a->z * b->z);
-}
-
-void vector_normalize(vector_f *a)
-{
-  float mag = sqrt(vector_dot(a, a));
-  a->x /= mag;
-  a->y /= mag;
-  a->z /= mag;
-}
-
 void calculate_acceleration(int16_t x, int16_t y, int16_t z) {
     // Calculate acceleration from accelerometer data.
     double g = 9.81;
@@ -118,7 +104,7 @@ void read_mag(int16_t* x, int16_t* y, int16_t* z) {
     *z = (uint16_t)((readI2CRegister(MAGNETOMETER_ADDRESS, MAGNETOMETER_Z_MSB) << 8) | readI2CRegister(MAGNETOMETER_ADDRESS, MAGNETOMETER_Z_LSB));
 }
 
-float heading(void)
+int heading(void)
 {
     vector_i temp_m = {};
     read_mag(&temp_m.x, &temp_m.y, &temp_m.z);
@@ -131,17 +117,17 @@ float heading(void)
     temp_m.y -= ((int32_t)m_min.y + m_max.y) / 2;
     temp_m.z -= ((int32_t)m_min.z + m_max.z) / 2;
 
-    // compute E and N
-    vector_f E;
-    vector_f N;
+    // compute E and N, kept in integers since there is no FPU
+    // E = m x a, N = a x E. a is perpendicular to E so |N| = |a||E|, which
+    // means atan2(E.x/|E|, N.x/|N|) == atan2(E.x*|a|, N.x) and no normalising is needed.
+    vector_l E;
+    vector_l N;
     vector_cross(&temp_m, &a, &E);
-    vector_normalize(&E);
     vector_cross2(&a, &E, &N);
-    vector_normalize(&N);
+    uint32_t a_len = isqrt32((uint32_t)(a.x * a.x) + (uint32_t)(a.y * a.y) + (uint32_t)(a.z * a.z));
 
     // compute heading
-    float heading = atan2(vector_dot(&E, &from), vector_dot(&N, &from)) * 180 / M_PI;
-    if (heading < 0) heading += 360;
-    return heading;
+    q16_t heading = q16_atan2_deg(E.x * a_len, N.x);
+    if (heading < 0) heading += Q16_FROM_INT(360);
+    return q16_to_int(heading) % 360;
 }
-
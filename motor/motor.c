@@ -12,8 +12,11 @@
 #include "hardware/pwm.h"
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
+#include "hardware/sync.h"
 #include "motor.h"
 #include "magnometer.h"
+#include "trace.h"
+#include "hotpath.h"
 
 // Left Motor
 #define ENB_PIN 5
@@ -40,6 +43,30 @@
 volatile long long  leftwheelcode = 0;
 volatile long long  rightwheelcode = 0;
 volatile unsigned int speed = 0;
+static uint16_t pwm_wrap = 0;
+// last committed levels, writes that would not change anything are skipped
+static uint16_t level_left = 0;
+static uint16_t level_right = 0;
+
+// time of the last three encoder edges, newest first. Speed is taken over the
+// two intervals between them so the uneven mark/space of the encoder disc cancels out
+static volatile uint32_t left_edge_us[3] = {0};
+static volatile uint32_t right_edge_us[3] = {0};
+
+// encoder count at which each wheel is braked from the ISR, -1 when unused
+static volatile long long left_target_code = -1;
+static volatile long long right_target_code = -1;
+// direction pins of wheels that reached their target, kept low by forward() etc.
+static volatile uint32_t hold_mask = 0;
+static void (*target_callback)(int wheel) = NULL;
+
+// signed edge totals for odometry, never reset. The encoders can't tell
+// direction so each edge counts the way the pins last drove that wheel,
+// which also covers coasting after stop().
+static volatile int32_t left_travel = 0;
+static volatile int32_t right_travel = 0;
+static volatile int8_t left_dir = 1;
+static volatile int8_t right_dir = 1;
 
 
 uint slice_num_1;
@@ -58,7 +85,7 @@ void init_engine() {
     gpio_set_dir(IN4_PIN, GPIO_OUT);
 }
 
-//initialise the motor
+//initialise the motor, default_speed is the level for 100% duty
 void init_motor(uint16_t default_speed) {
 
     gpio_set_function(ENA_PIN, GPIO_FUNC_PWM);
@@ -67,12 +94,15 @@ void init_motor(uint16_t default_speed) {
     slice_num_1 = pwm_gpio_to_slice_num(ENA_PIN);
     slice_num_2 = pwm_gpio_to_slice_num(ENB_PIN);
 
-    pwm_set_clkdiv(slice_num_1, 100);
-    pwm_set_clkdiv(slice_num_2, 100);
+    pwm_set_clkdiv_int_frac(slice_num_1, MOTOR_PWM_CLKDIV, 0);
+    pwm_set_clkdiv_int_frac(slice_num_2, MOTOR_PWM_CLKDIV, 0);
 
-    pwm_set_wrap(slice_num_1, default_speed);
-    pwm_set_wrap(slice_num_2, default_speed);
+    // counter runs 0..wrap, so a level of default_speed is fully on
+    pwm_wrap = default_speed;
+    pwm_set_wrap(slice_num_1, default_speed - 1);
+    pwm_set_wrap(slice_num_2, default_speed - 1);
 
+    level_left = level_right = default_speed;
     pwm_set_chan_level(slice_num_1, PWM_CHAN_A, default_speed);
     pwm_set_chan_level(slice_num_2, PWM_CHAN_B, default_speed);
 
@@ -80,26 +110,33 @@ void init_motor(uint16_t default_speed) {
     pwm_set_enabled(slice_num_2, true);
 }
 
+// Drive the direction pins, skipping wheels the encoder ISR has braked.
+// IRQs are off so a target hit can't land between reading hold_mask and the write.
+static void set_direction(uint32_t clr, uint32_t set) {
+    uint32_t irq = save_and_disable_interrupts();
+    gpio_clr_mask(clr);
+    gpio_set_mask(set & ~hold_mask);
+    left_dir = (set & LW_RV) ? -1 : 1;
+    right_dir = (set & RW_RV) ? -1 : 1;
+    restore_interrupts(irq);
+}
+
 //Move forward
 void forward() {
-    gpio_clr_mask(RW_RV | LW_RV);
-    gpio_set_mask(RW_FW | LW_FW);
+    set_direction(RW_RV | LW_RV, RW_FW | LW_FW);
 }
 
 //Move backward
 void backwards() {
-    gpio_clr_mask(RW_FW | LW_FW);
-    gpio_set_mask(RW_RV | LW_RV);
+    set_direction(RW_FW | LW_FW, RW_RV | LW_RV);
 }
 
 void rotate_clockwise(){
-    gpio_clr_mask(LEFT_WHEEL_PIN | RIGHT_WHEEL_PIN);
-    gpio_set_mask(RW_RV | LW_FW);
+    set_direction(LEFT_WHEEL_PIN | RIGHT_WHEEL_PIN, RW_RV | LW_FW);
 }
 
 void rotate_counter_clockwise(){
-    gpio_clr_mask(LEFT_WHEEL_PIN | RIGHT_WHEEL_PIN);
-    gpio_set_mask(RW_FW | LW_RV);
+    set_direction(LEFT_WHEEL_PIN | RIGHT_WHEEL_PIN, RW_FW | LW_RV);
 }
 
 void stop() {
@@ -121,29 +158,120 @@ void stop_right() {
 
 void set_speed(uint16_t current_speed){
     speed = current_speed;
-    pwm_set_chan_level(slice_num_1, PWM_CHAN_A, current_speed);
-    pwm_set_chan_level(slice_num_2, PWM_CHAN_B, current_speed);
+    set_wheel_speeds(current_speed, current_speed);
     return;
 }
 
-//Turn left 
-void left_tilt() {
-    //Slow right motor
-    pwm_set_chan_level(slice_num_2, PWM_CHAN_B, speed * 0.5);
+// Set each wheel's duty, left is ENB (chan B), right is ENA (chan A).
+// The CC register is double buffered by the PWM block and only latched at
+// wrap, and with both enable pins on one slice both levels go out in a
+// single 32 bit write, so a period never sees one new and one old level.
+void HOT(set_wheel_speeds)(uint16_t left, uint16_t right){
+    if (left == level_left && right == level_right)
+        return;
+    level_left = left;
+    level_right = right;
+    trace_event(TRACE_CONTROL, 0, left);
+    trace_event(TRACE_CONTROL, 1, right);
+    if (slice_num_1 == slice_num_2) {
+        pwm_set_both_levels(slice_num_1, right, left);
+    } else {
+        pwm_set_chan_level(slice_num_1, PWM_CHAN_A, right);
+        pwm_set_chan_level(slice_num_2, PWM_CHAN_B, left);
+    }
+}
+
+uint16_t get_pwm_wrap(){
+    return pwm_wrap;
+}
+
+// The hottest interrupts, kept in SRAM so a flash cache miss can't delay them
+void HOT(left_wheel_encoder_handler)(uint gpio, uint32_t events, void *ctx){
+    left_edge_us[2] = left_edge_us[1];
+    left_edge_us[1] = left_edge_us[0];
+    left_edge_us[0] = time_us_32();
+    left_travel += left_dir;
+    if (++leftwheelcode == left_target_code) {
+        // brake here rather than at the next control tick
+        hold_mask |= LEFT_WHEEL_PIN;
+        gpio_clr_mask(LEFT_WHEEL_PIN);
+        if (target_callback)
+            target_callback(WHEEL_LEFT);
+    }
+}
+
+void HOT(right_wheel_encoder_handler)(uint gpio, uint32_t events, void *ctx){
+    right_edge_us[2] = right_edge_us[1];
+    right_edge_us[1] = right_edge_us[0];
+    right_edge_us[0] = time_us_32();
+    right_travel += right_dir;
+    if (++rightwheelcode == right_target_code) {
+        hold_mask |= RIGHT_WHEEL_PIN;
+        gpio_clr_mask(RIGHT_WHEEL_PIN);
+        if (target_callback)
+            target_callback(WHEEL_RIGHT);
+    }
+}
+
+// Brake each wheel from the encoder ISR when its count reaches target.
+// Pass -1 to leave a wheel without a target.
+void set_encoder_target(long long left, long long right){
+    uint32_t irq = save_and_disable_interrupts();
+    left_target_code = left;
+    right_target_code = right;
+    hold_mask = 0;
+    // already there, hold it now since the ISR only checks for equality
+    if (left >= 0 && leftwheelcode >= left)
+        hold_mask |= LEFT_WHEEL_PIN;
+    if (right >= 0 && rightwheelcode >= right)
+        hold_mask |= RIGHT_WHEEL_PIN;
+    gpio_clr_mask(hold_mask);
+    restore_interrupts(irq);
+}
+
+void clear_encoder_target(){
+    set_encoder_target(-1, -1);
+}
+
+bool encoder_target_reached(){
+    return hold_mask == (LEFT_WHEEL_PIN | RIGHT_WHEEL_PIN);
+}
+
+void set_encoder_target_callback(void (*callback)(int wheel)){
+    target_callback = callback;
+}
+
+// Signed edges each wheel has turned since boot, + is forward
+void get_wheel_travel(int32_t *left, int32_t *right){
+    uint32_t irq = save_and_disable_interrupts();
+    *left = left_travel;
+    *right = right_travel;
+    restore_interrupts(irq);
 }
 
-//Turn right
-void right_tilt() {
-    //Slow left motor
-    pwm_set_chan_level(slice_num_1, PWM_CHAN_A, speed * 0.8);
+static int32_t HOT(edge_speed)(volatile uint32_t edge_us[3]){
+    // the encoder ISR must not shift the edges between the reads
+    uint32_t irq = save_and_disable_interrupts();
+    uint32_t last = edge_us[0];
+    uint32_t oldest = edge_us[2];
+    restore_interrupts(irq);
+    uint32_t interval = (last - oldest) / 2;
+    uint32_t elapsed = time_us_32() - last;
+    // no edge for longer than the last interval means we are slowing down
+    if (elapsed > interval)
+        interval = elapsed;
+    if (interval == 0 || interval > WHEEL_STALL_US)
+        return 0;
+    return 1000000 / interval;
 }
 
-void left_wheel_encoder_handler(uint32_t events){
-    ++leftwheelcode;
+// Encoder edges per second, from the time between edges rather than counts per tick
+int32_t HOT(left_wheel_speed)(){
+    return edge_speed(left_edge_us);
 }
 
-void right_wheel_encoder_handler(uint32_t events){
-    ++rightwheelcode;
+int32_t HOT(right_wheel_speed)(){
+    return edge_speed(right_edge_us);
 }
 
 void reset_wheel_encoder(){
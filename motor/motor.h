@@ -1,4 +1,5 @@
 #include "stdint.h"
+#include "stdbool.h"
 #ifndef motor_h
 #define motor_h
 void init_engine();
@@ -6,20 +7,35 @@ void init_motor(uint16_t default_speed);
 void forward();
 void backwards();
 void stop();
-void left_tilt();
-void right_tilt();
 void set_speed(uint16_t current_speed);
+void set_wheel_speeds(uint16_t left, uint16_t right);
+uint16_t get_pwm_wrap();
 // void move_forward_with_distance(int wheel_encoder_pin, int IN1_PIN, int IN2_PIN, int IN3_PIN, int IN4_PIN, double distance);
 
+// 125MHz / 1 / 12500 = 10kHz, above the audible range and twice the duty
+// resolution of the old 200Hz setup (clkdiv 100, wrap 6250)
+#define MOTOR_PWM_CLKDIV 1
+#define MOTOR_PWM_TOP 12500
+
 #define right_wheel_encoder_pin 3
 #define left_wheel_encoder_pin 2
 extern volatile long long leftwheelcode;
 extern volatile long long rightwheelcode;
-void left_wheel_encoder_handler();
-void right_wheel_encoder_handler();
+void left_wheel_encoder_handler(unsigned int gpio, uint32_t events, void *ctx);
+void right_wheel_encoder_handler(unsigned int gpio, uint32_t events, void *ctx);
 void rotate_clockwise();
 void rotate_counter_clockwise();
 void reset_wheel_encoder();
+int32_t left_wheel_speed();
+int32_t right_wheel_speed();
+#define WHEEL_STALL_US 200000 // slower than 5 edges/s reads as stopped
+#define WHEEL_LEFT 0
+#define WHEEL_RIGHT 1
+void set_encoder_target(long long left, long long right);
+void clear_encoder_target();
+bool encoder_target_reached();
+void set_encoder_target_callback(void (*callback)(int wheel));
+void get_wheel_travel(int32_t *left, int32_t *right);
 #define DIST_5CM 10
 #define DIST_10CM 20
 #define DIST_20CM 40
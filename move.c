@@ -0,0 +1,808 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "pico/stdlib.h"
+#include "Server.h"
+#include "motor.h"
+#include "fixed.h"
+#include "looptimer.h"
+#include "events.h"
+#include "command.h"
+#include "mission.h"
+#include "teleop.h"
+#include "stream.h"
+#include "telemetry.h"
+#include "logging.h"
+#include "trace.h"
+#include "irqbench.h"
+#include "drive.h"
+#include "profile.h"
+#include "feedforward.h"
+#include "odometry.h"
+#include "move.h"
+
+volatile q16_t tkp = Q16(0.1), tki = 0, tkd = Q16(0.05);
+volatile q16_t fkp = Q16(0.15), fki = 0, fkd = Q16(0.075);
+
+typedef enum move_mode_ {
+    MODE_PAUSED,
+    MODE_FORWARD,
+    MODE_BARCODE,
+    MODE_REVERSE_WAIT, // stopped after overshooting, about to reverse
+    MODE_REVERSE,
+    MODE_TURN,
+    MODE_CHARACTERISE,
+    MODE_BENCH,
+    MODE_WAIT,         // stopped until the ultrasonic reading crosses OBSTACLE_CM
+    MODE_TELEOP,
+    MODE_ARC,
+    MODE_GOTO,
+    MODE_FACE,         // turn on the spot to the goto heading
+    MODE_COUNT
+} move_mode;
+
+typedef struct move_state_ {
+    move_mode mode;
+    uint32_t events; // what woke this pass
+    bool outer;      // divided tick: step profiles, position PIDs and counters only then
+    char steadycount;
+
+    long long target_code;
+    int dist_error;
+    int dist_last_error;
+
+    int target_bearing;
+    int turn_start;
+    int bearing_error;
+    int bearing_last_error;
+    int track_error;
+
+    bool wait_for_obstacle;
+    int bench; // 0 fixed point, 1 interrupt latency
+
+    q16_t arc_ratio;   // wheel difference over centre speed, track / radius, + clockwise
+    q16_t goto_x, goto_y;
+    int32_t goto_heading;
+    int32_t goto_speed;
+
+    int32_t intergral;
+    int32_t derivative;
+    q16_t control;
+    motion_profile profile;
+} move_state;
+
+int get_bearing_error(int current, int target)
+{
+    int error = target - current;
+    if (error > 180)
+        return error - 360;
+    if (error < -180)
+        return error + 360;
+    return error;
+}
+
+// called from the encoder ISR when a wheel reaches its target count
+static void encoder_target_callback(int wheel)
+{
+    move_event_signal(MOVE_EVT_ENCODER);
+}
+
+static void send_update(const char *update_data)
+{
+    telemetry_publish(TLM_PID, update_data);
+}
+
+static void send_event(const char *update_data)
+{
+    telemetry_publish(TLM_EVENTS, update_data);
+}
+
+static void send_mission_report(void)
+{
+    char update_data[100] = "";
+    mission_report(update_data, 100);
+    send_event(update_data);
+}
+
+// at the PID stream rate, see "tlm"
+static bool update_due(move_state *m)
+{
+    return telemetry_due(TLM_PID);
+}
+
+static void start_distance(move_state *m, int32_t dist)
+{
+    LOG("distanceBuffer: %ld\n", dist);
+    reset_wheel_encoder();
+    drive_reset();
+    m->control = 0; // passes before the first outer tick use it as is
+    m->target_code = dist;
+    set_encoder_target(m->target_code, m->target_code);
+    profile_start(&m->profile, dist, DRIVE_MAX_SPEED, DRIVE_MAX_ACCEL, looptimer_rate() / CASCADE_OUTER_DIV);
+}
+
+// brake along the profile rather than reversing
+static void brake_distance(move_state *m)
+{
+    profile_stop(&m->profile);
+    m->target_code = profile_end(&m->profile);
+    set_encoder_target(m->target_code, m->target_code);
+}
+
+/* Commands: each returns the mode to continue in. */
+
+static move_mode cmd_stop(move_state *m, const move_cmd *cmd)
+{
+    stop();
+    m->profile.done = true;
+    m->target_bearing = current_bearing;
+    return MODE_PAUSED;
+}
+
+static move_mode cmd_fwd(move_state *m, const move_cmd *cmd)
+{
+    if (cmd->arg[0] > 0)
+    {
+        start_distance(m, cmd->arg[0]);
+        return MODE_FORWARD;
+    }
+    if (cmd->arg[0] == -1 && (m->mode == MODE_FORWARD || m->mode == MODE_BARCODE))
+        brake_distance(m);
+    return m->mode;
+}
+
+static move_mode cmd_bar(move_state *m, const move_cmd *cmd)
+{
+    start_distance(m, cmd->arg[0]);
+    return MODE_BARCODE;
+}
+
+static move_mode cmd_turn(move_state *m, const move_cmd *cmd)
+{
+    LOG("readbearing: %ld\n", cmd->arg[0]);
+    m->target_bearing += cmd->arg[0];
+    if (m->target_bearing > 360)
+        m->target_bearing -= 360;
+    if (m->target_bearing < 0)
+        m->target_bearing += 360;
+    m->turn_start = current_bearing;
+    m->intergral = 0;
+    drive_reset(); // turn drives the PWM directly
+    clear_encoder_target();
+    profile_start(&m->profile, get_bearing_error(current_bearing, m->target_bearing), TURN_MAX_RATE, TURN_MAX_ACCEL, looptimer_rate() / CASCADE_OUTER_DIV);
+    return MODE_TURN;
+}
+
+static move_mode cmd_bench(move_state *m, const move_cmd *cmd)
+{
+    m->bench = cmd->arg[0];
+    return MODE_BENCH;
+}
+
+static move_mode cmd_char(move_state *m, const move_cmd *cmd)
+{
+    drive_reset();
+    clear_encoder_target();
+    ff_characterize_start();
+    return MODE_CHARACTERISE;
+}
+
+static move_mode cmd_wait(move_state *m, const move_cmd *cmd)
+{
+    stop();
+    drive_reset();
+    clear_encoder_target();
+    m->wait_for_obstacle = cmd->arg[0] != 0;
+    return MODE_WAIT;
+}
+
+// steps are started from the main loop once the current mode is paused
+static move_mode cmd_mission(move_state *m, const move_cmd *cmd)
+{
+    stop();
+    m->profile.done = true;
+    mission_start();
+    return MODE_PAUSED;
+}
+
+static move_mode cmd_teleop(move_state *m, const move_cmd *cmd)
+{
+    stop();
+    drive_reset();
+    clear_encoder_target();
+    m->profile.done = true;
+    teleop_reset();
+    return MODE_TELEOP;
+}
+
+static move_mode cmd_arc(move_state *m, const move_cmd *cmd)
+{
+    int32_t radius = cmd->arg[0];
+    int32_t angle = cmd->arg[1];
+    // tighter than half the track the inner wheel would have to reverse
+    if (2 * radius < ODOM_TRACK_MM || angle == 0)
+        return m->mode;
+    // centre line length in edges, each wheel covers (radius +- track/2) / radius of it
+    int32_t centre = q16_to_int(q16_mul_int(Q16(3.14159265 / 180 / ODOM_EDGE_MM), radius * abs(angle)));
+    int32_t outer = centre * (2 * radius + ODOM_TRACK_MM) / (2 * radius);
+    int32_t inner = centre * (2 * radius - ODOM_TRACK_MM) / (2 * radius);
+    LOG("arc: r %ld a %ld, centre %ld edges\n", radius, angle, centre);
+    reset_wheel_encoder();
+    drive_reset();
+    m->control = 0;
+    m->target_code = centre;
+    m->arc_ratio = Q16_FROM_INT(ODOM_TRACK_MM) / radius;
+    if (angle > 0)
+    {
+        set_encoder_target(outer, inner);
+    }
+    else
+    {
+        m->arc_ratio = -m->arc_ratio;
+        set_encoder_target(inner, outer);
+    }
+    // keep the outer wheel within DRIVE_MAX_SPEED
+    profile_start(&m->profile, centre, DRIVE_MAX_SPEED * 2 * radius / (2 * radius + ODOM_TRACK_MM), DRIVE_MAX_ACCEL, looptimer_rate() / CASCADE_OUTER_DIV);
+    return MODE_ARC;
+}
+
+static move_mode cmd_goto(move_state *m, const move_cmd *cmd)
+{
+    LOG("goto: %ld,%ld\n", cmd->arg[0], cmd->arg[1]);
+    m->goto_x = Q16_FROM_INT(cmd->arg[0]);
+    m->goto_y = Q16_FROM_INT(cmd->arg[1]);
+    m->goto_heading = cmd->arg[2];
+    m->goto_speed = 0;
+    m->profile.done = true;
+    m->steadycount = 50;
+    drive_reset();
+    clear_encoder_target();
+    return MODE_GOTO;
+}
+
+static move_mode (*const command_table[CMD_COUNT])(move_state *, const move_cmd *) = {
+    [CMD_STOP] = cmd_stop,
+    [CMD_FWD] = cmd_fwd,
+    [CMD_BAR] = cmd_bar,
+    [CMD_TURN] = cmd_turn,
+    [CMD_BENCH] = cmd_bench,
+    [CMD_CHAR] = cmd_char,
+    [CMD_WAIT] = cmd_wait,
+    [CMD_MISSION] = cmd_mission,
+    [CMD_TELEOP] = cmd_teleop,
+    [CMD_ARC] = cmd_arc,
+    [CMD_GOTO] = cmd_goto,
+};
+
+/* Modes: one position loop pass each, returns the next mode. */
+
+static move_mode step_paused(move_state *m)
+{
+    stop();
+    drive_reset();
+    clear_encoder_target();
+    if (m->events == 0) // idle timeout
+    {
+        char update_data[100] = "";
+        snprintf(update_data, 100, "[P]lc:%llu\tlr:%llu\ttc:%llu\tec:%d\tcb:%d\ttb:%d\teb:%d\n", leftwheelcode, rightwheelcode, m->target_code, m->dist_error, current_bearing, m->target_bearing, m->bearing_error);
+        send_update(update_data);
+    }
+    return MODE_PAUSED;
+}
+
+// fwd and bar: follow the profile setpoint, control is a correction on top of the profile velocity
+static move_mode step_forward(move_state *m)
+{
+    move_mode next = m->mode;
+    if (ultrasonic_reading < OBSTACLE_CM)
+        brake_distance(m);
+
+    if (m->outer)
+    {
+        profile_step(&m->profile);
+        m->dist_error = m->target_code - leftwheelcode;
+        m->dist_last_error = m->track_error;
+        m->track_error = profile_position(&m->profile) - leftwheelcode;
+        m->derivative = m->track_error - m->dist_last_error;
+        // Code will increase going backwards too
+        if (m->profile.done && m->dist_error < 2)
+        {
+            m->control = 0;
+            if (encoder_target_reached() || --m->steadycount == 0)
+            {
+                m->steadycount = 50;
+                if (m->dist_error < -2){
+                    stop();
+                    LOG("lc was %ld, rc was %ld, set tc to %ld\n", (long)leftwheelcode, (long)rightwheelcode, (long)m->target_code);
+                    next = MODE_REVERSE_WAIT;
+                }else{
+                    next = MODE_PAUSED;
+                }
+            }
+        }else{
+            m->control = q16_mul_int(fkp, m->track_error);
+            m->steadycount = 50;
+        }
+        m->control += q16_mul_int(fkd, m->derivative);
+        m->control = q16_clamp(m->control, -Q16_ONE, Q16_ONE);
+    }
+    // events (IR, obstacle) act straight away on the last control output
+    int32_t steer = 0;
+    if (m->mode == MODE_FORWARD)
+    {
+        if (leftIRblack)
+            steer += DRIVE_IR_STEER; // line on the left, slow the right wheel
+        if (rightIRblack)
+            steer -= DRIVE_IR_STEER;
+    }
+    drive_set_target(profile_velocity(&m->profile) + q16_scale(m->control, DRIVE_MAX_SPEED), steer);
+    forward();
+
+    if (update_due(m))
+    {
+        char update_data[100] = "";
+        uint16_t speed = profile_velocity(&m->profile);
+        snprintf(update_data, 100, "[%s]lc:%llu\tlr:%llu\ttar:%llu\terr:%d\tctrl:" Q16_FMT "\tp:" Q16_FMT "\td:%ld\tspeed:%d\n", m->mode == MODE_FORWARD ? "FWD" : "BAR", leftwheelcode, rightwheelcode, m->target_code, m->dist_error, Q16_ARGS(m->control), Q16_ARGS(fkp), m->derivative, speed);
+        send_update(update_data);
+    }
+    return next;
+}
+
+static move_mode step_reverse_wait(move_state *m)
+{
+    vTaskDelay(100); // wheels to stop completely
+    m->target_code = leftwheelcode;
+    LOG("lc was %ld, rc was %ld, set tc to %ld\n", (long)leftwheelcode, (long)rightwheelcode, (long)m->target_code);
+    long long right_offset = rightwheelcode - leftwheelcode;
+    reset_wheel_encoder();
+    rightwheelcode = right_offset;
+    drive_reset();
+    set_encoder_target(m->target_code, m->target_code + right_offset);
+    return MODE_REVERSE;
+}
+
+static move_mode step_reverse(move_state *m)
+{
+    move_mode next = MODE_REVERSE;
+    if (m->outer)
+    {
+        m->dist_last_error = m->dist_error;
+        m->dist_error = m->target_code - leftwheelcode;
+        m->derivative = m->dist_error - m->dist_last_error;
+        // Code will increase going backwards too
+        if (m->dist_error < 2)
+        {
+            m->control = 0;
+            if (--m->steadycount == 0)
+            {
+                next = MODE_PAUSED;
+                m->steadycount = 50;
+            }
+        }else{
+            m->control = q16_mul_int(fkp, m->dist_error);
+            m->steadycount = 50;
+        }
+        m->control += q16_mul_int(fkd, m->derivative);
+        m->control = q16_clamp(m->control, 0, Q16_ONE);
+    }
+    drive_set_target(q16_scale(m->control, DRIVE_MAX_SPEED), 0);
+    backwards();
+
+    if (update_due(m))
+    {
+        char update_data[100] = "";
+        uint16_t speed = q16_scale(m->control, DEFAULT_SPEED);
+        snprintf(update_data, 100, "[RVE]lc:%llu\tlr:%llu\ttar:%llu\terr:%d\tctrl:" Q16_FMT "\tp:" Q16_FMT "\td:%ld\tspeed:%d\n", leftwheelcode, rightwheelcode, m->target_code, m->dist_error, Q16_ARGS(m->control), Q16_ARGS(fkp), m->derivative, speed);
+        send_update(update_data);
+    }
+    return next;
+}
+
+// track the profiled bearing, feedforward the profile rate as duty
+static move_mode step_turn(move_state *m)
+{
+    move_mode next = MODE_TURN;
+    // the turn drives the PWM directly, nothing to refresh between ticks
+    if (!m->outer)
+        return next;
+    profile_step(&m->profile);
+    m->bearing_last_error = m->track_error;
+    m->track_error = get_bearing_error(current_bearing, (m->turn_start + profile_position(&m->profile) + 360) % 360);
+    m->intergral += m->track_error;
+    m->derivative = m->track_error - m->bearing_last_error;
+
+    if (!m->profile.done || abs(m->bearing_error) > 3)
+    {
+        m->control = Q16_FROM_INT(profile_velocity(&m->profile)) / TURN_FULL_DUTY_RATE + q16_mul_int(tkp, m->track_error);
+        m->steadycount = 50;
+    }
+    else
+    {
+        if (--m->steadycount == 0)
+        {
+            next = MODE_PAUSED;
+            m->steadycount = 50;
+        }
+        m->control = 0;
+    }
+    m->control += q16_mul_int(tki, m->intergral) + q16_mul_int(tkd, m->derivative);
+
+    if (m->control > 0)
+    {
+        // set direction here
+        rotate_clockwise();
+    }
+    else
+    {
+        rotate_counter_clockwise();
+    }
+    m->control = q16_clamp(q16_abs(m->control), 0, Q16_ONE);
+    set_speed(q16_scale(m->control, DEFAULT_SPEED));
+    if (update_due(m))
+    {
+        char update_data[100] = "";
+        uint16_t speed = q16_scale(m->control, DEFAULT_SPEED);
+        snprintf(update_data, 100, "[TUN]cur:%d\ttar:%d\terr:%d\tctrl:" Q16_FMT "\tp:" Q16_FMT "\tspeed:%d\n", current_bearing, m->target_bearing, m->bearing_error, Q16_ARGS(m->control), Q16_ARGS(tkp), speed);
+        send_update(update_data);
+    }
+    return next;
+}
+
+static move_mode step_characterise(move_state *m)
+{
+    // the sweep counts outer ticks, extra wakeups would shorten its windows
+    if (!m->outer)
+        return MODE_CHARACTERISE;
+    forward();
+    if (!ff_characterize_step())
+        return MODE_CHARACTERISE;
+    stop();
+    ff_save();
+    LOG("feedforward table saved, deadband l:%u r:%u\n", ff_deadband(FF_LEFT), ff_deadband(FF_RIGHT));
+    return MODE_PAUSED;
+}
+
+static move_mode step_bench(move_state *m)
+{
+    stop();
+    char update_data[100] = "";
+    if (m->bench == 1)
+    {
+        // warm then cold, run the same on a BLINKY_HOT_IN_RAM=OFF build to compare
+        static irqbench_result r;
+        for (int cold = 0; cold < 2; ++cold)
+        {
+            irqbench_run(&r, cold);
+            int len;
+            for (int line = 0; (len = irqbench_report(&r, update_data, sizeof(update_data), line)) > 0; ++line)
+                send_event(update_data);
+        }
+        return MODE_PAUSED;
+    }
+    fixed_benchmark(update_data, 100);
+    send_event(update_data);
+    return MODE_PAUSED;
+}
+
+// woken by the MOVE_EVT_SENSOR sense_task raises when the obstacle state flips
+static move_mode step_wait(move_state *m)
+{
+    if ((ultrasonic_reading < OBSTACLE_CM) == m->wait_for_obstacle)
+        return MODE_PAUSED;
+    return MODE_WAIT;
+}
+
+// wheel targets straight from the newest UDP setpoint, stopped while it is stale
+static move_mode step_teleop(move_state *m)
+{
+    teleop_setpoint sp;
+    int32_t left = 0, right = 0;
+    if (teleop_latest(&sp))
+    {
+        left = MAX(-DRIVE_MAX_SPEED, MIN(sp.linear + sp.angular / 2, DRIVE_MAX_SPEED));
+        right = MAX(-DRIVE_MAX_SPEED, MIN(sp.linear - sp.angular / 2, DRIVE_MAX_SPEED));
+    }
+    if (left == 0 && right == 0)
+    {
+        stop();
+        drive_reset();
+    }
+    else
+    {
+        // the encoders only count edges, so wheel direction comes from the pins
+        drive_set_target((abs(left) + abs(right)) / 2, abs(left) - abs(right));
+        if (left >= 0 && right >= 0)
+            forward();
+        else if (left <= 0 && right <= 0)
+            backwards();
+        else if (left > 0)
+            rotate_clockwise();
+        else
+            rotate_counter_clockwise();
+    }
+
+    if (update_due(m))
+    {
+        char update_data[100] = "";
+        snprintf(update_data, 100, "[TOP]seq:%lu\tlin:%d\tang:%d\tl:%ld/%ld\tr:%ld/%ld\n", sp.seq, sp.linear, sp.angular, left, left_wheel.speed, right, right_wheel.speed);
+        send_update(update_data);
+    }
+    return MODE_TELEOP;
+}
+
+// follow the profile along the centre line, the steer keeps the wheel ratio of the arc
+static move_mode step_arc(move_state *m)
+{
+    move_mode next = MODE_ARC;
+    if (ultrasonic_reading < OBSTACLE_CM)
+    {
+        profile_stop(&m->profile);
+        m->target_code = profile_end(&m->profile);
+        clear_encoder_target();
+    }
+
+    if (m->outer)
+    {
+        profile_step(&m->profile);
+        int32_t travelled = (leftwheelcode + rightwheelcode) / 2;
+        m->dist_error = m->target_code - travelled;
+        m->dist_last_error = m->track_error;
+        m->track_error = profile_position(&m->profile) - travelled;
+        m->derivative = m->track_error - m->dist_last_error;
+        if (m->profile.done && m->dist_error < 2)
+        {
+            m->control = 0;
+            if (encoder_target_reached() || --m->steadycount == 0)
+            {
+                m->steadycount = 50;
+                next = MODE_PAUSED;
+            }
+        }else{
+            m->control = q16_mul_int(fkp, m->track_error);
+            m->steadycount = 50;
+        }
+        m->control += q16_mul_int(fkd, m->derivative);
+        m->control = q16_clamp(m->control, -Q16_ONE, Q16_ONE);
+    }
+    int32_t speed = profile_velocity(&m->profile) + q16_scale(m->control, DRIVE_MAX_SPEED);
+    drive_set_target(speed, q16_to_int(q16_mul_int(m->arc_ratio, speed)));
+    forward();
+
+    if (update_due(m))
+    {
+        char update_data[100] = "";
+        snprintf(update_data, 100, "[ARC]lc:%llu\tlr:%llu\ttar:%llu\terr:%d\tctrl:" Q16_FMT "\tspeed:%ld\n", leftwheelcode, rightwheelcode, m->target_code, m->dist_error, Q16_ARGS(m->control), speed);
+        send_update(update_data);
+    }
+    return next;
+}
+
+static void spin_towards(q16_t error, int32_t speed)
+{
+    drive_set_target(speed, 0);
+    if (error > 0)
+        rotate_clockwise();
+    else
+        rotate_counter_clockwise();
+}
+
+// steer onto the bearing to the point from the odometry pose, no stop to turn unless it is far off
+static move_mode step_goto(move_state *m)
+{
+    int32_t dx = q16_to_int(m->goto_x - odom_pose.x);
+    int32_t dy = q16_to_int(m->goto_y - odom_pose.y);
+    int32_t dist = isqrt64((int64_t)dx * dx + (int64_t)dy * dy);
+    q16_t error = odom_wrap180(q16_atan2_deg(dy, dx) - odom_pose.heading);
+    int32_t error_deg = q16_to_int(error);
+
+    // there, or just past it
+    if (dist <= GOTO_TOLERANCE_MM || (dist <= 2 * GOTO_TOLERANCE_MM && abs(error_deg) > 90))
+    {
+        stop();
+        drive_reset();
+        return m->goto_heading == CMD_NO_HEADING ? MODE_PAUSED : MODE_FACE;
+    }
+    if (ultrasonic_reading < OBSTACLE_CM)
+    {
+        stop();
+        drive_reset();
+        return MODE_PAUSED;
+    }
+
+    if (abs(error_deg) > GOTO_SPIN_DEG)
+    {
+        m->goto_speed = 0;
+        spin_towards(error, GOTO_SPIN_SPEED);
+    }
+    else
+    {
+        // fastest speed that can still stop in the distance left, ramped up at DRIVE_MAX_ACCEL
+        int32_t edges = q16_to_int(q16_mul_int(ODOM_EDGES_PER_MM, dist));
+        int32_t speed = MIN(DRIVE_MAX_SPEED, (int32_t)isqrt32(2 * DRIVE_MAX_ACCEL * edges));
+        if (m->outer)
+            m->goto_speed = MIN(speed, m->goto_speed + DRIVE_MAX_ACCEL * CASCADE_OUTER_DIV / looptimer_rate());
+        else
+            m->goto_speed = MIN(speed, m->goto_speed);
+        int32_t steer = MAX(-2 * m->goto_speed, MIN(error_deg * GOTO_STEER_PER_DEG, 2 * m->goto_speed));
+        drive_set_target(m->goto_speed, steer);
+        forward();
+    }
+
+    if (update_due(m))
+    {
+        char update_data[100] = "";
+        snprintf(update_data, 100, "[GTO]x:%ld\ty:%ld\th:%ld\tdist:%ld\terr:%ld\tspeed:%ld\n", q16_to_int(odom_pose.x), q16_to_int(odom_pose.y), q16_to_int(odom_pose.heading), dist, error_deg, m->goto_speed);
+        send_update(update_data);
+    }
+    return MODE_GOTO;
+}
+
+static move_mode step_face(move_state *m)
+{
+    q16_t error = odom_wrap180(Q16_FROM_INT(m->goto_heading) - odom_pose.heading);
+    if (q16_abs(error) <= Q16_FROM_INT(FACE_TOLERANCE_DEG))
+    {
+        stop();
+        drive_reset();
+        if (m->outer && --m->steadycount == 0)
+        {
+            m->steadycount = 50;
+            return MODE_PAUSED;
+        }
+        return MODE_FACE;
+    }
+    m->steadycount = 50;
+    // slow down over the last GOTO_SPIN_DEG degrees
+    int32_t error_deg = MIN(q16_to_int(q16_abs(error)), GOTO_SPIN_DEG);
+    spin_towards(error, MAX(GOTO_SPIN_SPEED / 4, GOTO_SPIN_SPEED * error_deg / GOTO_SPIN_DEG));
+    return MODE_FACE;
+}
+
+static move_mode (*const mode_table[MODE_COUNT])(move_state *) = {
+    [MODE_PAUSED] = step_paused,
+    [MODE_FORWARD] = step_forward,
+    [MODE_BARCODE] = step_forward,
+    [MODE_REVERSE_WAIT] = step_reverse_wait,
+    [MODE_REVERSE] = step_reverse,
+    [MODE_TURN] = step_turn,
+    [MODE_CHARACTERISE] = step_characterise,
+    [MODE_BENCH] = step_bench,
+    [MODE_WAIT] = step_wait,
+    [MODE_TELEOP] = step_teleop,
+    [MODE_ARC] = step_arc,
+    [MODE_GOTO] = step_goto,
+    [MODE_FACE] = step_face,
+};
+
+// one UDP telemetry sample of the loop state, taken right after the wheel loops ran
+static void stream_capture(const move_state *m)
+{
+    stream_sample s = {
+        .t_us = time_us_32(),
+        .left_count = leftwheelcode,
+        .right_count = rightwheelcode,
+        .left_speed = left_wheel.speed,
+        .right_speed = right_wheel.speed,
+        .left_target = left_wheel.target,
+        .right_target = right_wheel.target,
+        .left_pwm = left_wheel.pwm,
+        .right_pwm = right_wheel.pwm,
+        .bearing = current_bearing,
+        .bearing_error = m->bearing_error,
+        .x = odom_pose.x,
+        .y = odom_pose.y,
+        .heading = odom_pose.heading,
+        .ultrasonic = MIN(ultrasonic_reading, UINT16_MAX),
+        .mode = m->mode,
+    };
+    stream_push(&s);
+}
+
+// modes that need the control loop tick
+static bool mode_active(move_mode mode)
+{
+    return mode != MODE_PAUSED && mode != MODE_BENCH && mode != MODE_WAIT;
+}
+
+void move_task(__unused void *params)
+{
+    move_state m = {
+        .mode = MODE_PAUSED,
+        .steadycount = 50,
+        .target_bearing = current_bearing,
+        .profile = {.done = true},
+    };
+    printf("taskrunning\n");
+    drive_init();
+    set_encoder_target_callback(encoder_target_callback);
+    move_events_init(xTaskGetCurrentTaskHandle());
+    looptimer_init(CONTROL_LOOP_HZ);
+    int outer_tick = 0;
+
+    while (1)
+    {
+        // the loop tick only runs while a controller is active, otherwise sleep until an event
+        uint32_t events = move_event_wait(looptimer_enabled() ? portMAX_DELAY : pdMS_TO_TICKS(IDLE_REPORT_MS));
+        bool tick = events & MOVE_EVT_TICK;
+        bool outer = false;
+        if (tick)
+        {
+            looptimer_mark_wake();
+            trace_event(TRACE_LOOP_WAKE, 0, outer_tick);
+            // inner loop: wheel velocity, every period
+            drive_update();
+            if (telemetry_wanted(TLM_ENCODERS))
+                telemetry_sample_wheels(left_wheel.speed, right_wheel.speed);
+            if (stream_due())
+                stream_capture(&m);
+            // any other event is handled straight away, but the profile and
+            // position loops only step on the divided tick so events can't speed them up
+            outer = ++outer_tick >= CASCADE_OUTER_DIV;
+            if (outer)
+                outer_tick = 0;
+            else if (!(events & ~MOVE_EVT_TICK))
+            {
+                trace_event(TRACE_LOOP_DONE, 0, 0);
+                looptimer_body_done();
+                continue;
+            }
+        }
+
+        // outer loop: position, sets the velocity targets for the inner loop
+        m.events = events;
+        m.outer = outer;
+        move_cmd cmd;
+        if ((events & MOVE_EVT_COMMAND) && command_receive(&cmd))
+        {
+            // anything sent by hand takes over from a running mission
+            if (cmd.op != CMD_MISSION && mission_active())
+            {
+                mission_abort();
+                send_mission_report();
+            }
+            if (cmd.op < CMD_COUNT)
+                m.mode = command_table[cmd.op](&m, &cmd);
+            command_applied(&cmd);
+            // one command per pass, come back for the next one
+            if (command_pending())
+                move_event_signal(MOVE_EVT_COMMAND);
+        }
+        move_mode pass_mode = m.mode;
+        odom_update();
+        m.bearing_error = get_bearing_error(current_bearing, m.target_bearing);
+        m.mode = mode_table[m.mode](&m);
+
+        // start the next mission step in the same pass the last one finished
+        while (m.mode == MODE_PAUSED && mission_active())
+        {
+            bool more = mission_next(&cmd);
+            send_mission_report();
+            if (!more)
+                break;
+            m.mode = command_table[cmd.op](&m, &cmd);
+        }
+
+        // a mode change made in this pass (move finished, reverse) is handled
+        // right away instead of waiting for the next event
+        if (m.mode != pass_mode)
+            move_event_signal(MOVE_EVT_MODE);
+        if (!looptimer_enable(mode_active(m.mode)))
+        {
+            // without ticks the controller never runs and the wheels keep their last duty
+            LOG("no alarm for the control loop, stopping\n");
+            stop();
+            drive_reset();
+            if (mission_active())
+            {
+                mission_abort();
+                send_mission_report();
+            }
+            m.mode = MODE_PAUSED;
+        }
+        trace_event(TRACE_LOOP_DONE, 1, m.mode);
+        if (tick)
+            looptimer_body_done();
+    }
+}
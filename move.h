@@ -0,0 +1,44 @@
+#ifndef move_h
+#define move_h
+#include "pico/stdlib.h"
+#include "fixed.h"
+#include "motor.h"
+
+#define DEFAULT_SPEED MOTOR_PWM_TOP // full duty, control output 0..1 scales to this
+
+// Cascade: the wheel velocity loops run every looptimer period, the position
+// loops (fwd/bar/rev/turn) every CASCADE_OUTER_DIV periods. 500Hz / 5 keeps the
+// position loop at the 100Hz it was tuned at.
+#define CONTROL_LOOP_HZ 500
+#define CASCADE_OUTER_DIV 5
+
+// turn profile, degrees
+#define TURN_MAX_RATE 180
+#define TURN_MAX_ACCEL 360
+#define TURN_FULL_DUTY_RATE 360 // rough spin rate at full duty, used as feedforward
+
+// goto: drive towards the point, turning on the spot first if it is far off to one side
+#define GOTO_TOLERANCE_MM 20
+#define GOTO_SPIN_DEG 45      // heading error above which goto turns on the spot
+#define GOTO_SPIN_SPEED 60    // edges/s per wheel when turning on the spot
+#define GOTO_STEER_PER_DEG 2  // edges/s of wheel difference per degree of heading error
+#define FACE_TOLERANCE_DEG 2
+
+#define OBSTACLE_CM 15
+// with no controller running move_task only wakes for events, or this often to report
+#define IDLE_REPORT_MS 1000
+
+// gains are Q16.16, the M0+ has no FPU
+extern volatile q16_t tkp, tki, tkd;
+extern volatile q16_t fkp, fki, fkd;
+
+// written by sense_task and the IR interrupt
+extern int volatile current_bearing;
+extern uint32_t ultrasonic_reading;
+extern bool leftIRblack;
+extern bool rightIRblack;
+
+int get_bearing_error(int current, int target);
+void move_task(__unused void *params);
+
+#endif
@@ -0,0 +1,301 @@
+#include <string.h>
+#include "proto.h"
+#include "fixed.h"
+
+enum {
+    ST_IDLE,
+    ST_LEN,
+    ST_BODY,
+    ST_TEXT,
+    ST_SKIP, // rest of an overlong text line
+};
+
+typedef struct proto_word_ {
+    const char *word;
+    uint8_t op;
+    bool has_default;
+    int32_t arg; // used when the line carries no number
+} proto_word;
+
+// sorted for the binary search in find_word
+static const proto_word words[] = {
+    {"arc", PROTO_ARC},
+    {"bar", PROTO_BAR, true, 200},
+    {"bench", PROTO_BENCH},
+    {"char", PROTO_CHAR},
+    {"cmdstats", PROTO_CMDSTATS},
+    {"fftable", PROTO_FFTABLE},
+    {"fwd", PROTO_FWD},
+    {"goto", PROTO_GOTO},
+    {"isr", PROTO_ISR},
+    {"jitter", PROTO_JITTER},
+    {"mission", PROTO_MISSION},
+    {"netstats", PROTO_NETSTATS},
+    {"pose", PROTO_POSE},
+    {"rate", PROTO_RATE},
+    {"reset", PROTO_RESET},
+    {"start", PROTO_START},
+    {"stats", PROTO_STATS},
+    {"stop", PROTO_STOP},
+    {"stream", PROTO_STREAM},
+    {"sub", PROTO_SUB},
+    {"teleop", PROTO_TELEOP},
+    {"tlm", PROTO_TLM},
+    {"trace", PROTO_TRACE, true, 0},
+    {"tracedump", PROTO_TRACE, true, 3},
+    {"tracestart", PROTO_TRACE, true, 1},
+    {"tracestop", PROTO_TRACE, true, 2},
+    {"turnccw", PROTO_TURN, true, -90},
+    {"turncw", PROTO_TURN, true, 90},
+};
+#define NUM_WORDS (sizeof(words) / sizeof(words[0]))
+
+void proto_init(proto_parser *pp, proto_handler handler, void *ctx)
+{
+    memset(pp, 0, sizeof(*pp));
+    pp->handler = handler;
+    pp->ctx = ctx;
+}
+
+static const proto_word *find_word(const char *s, int n)
+{
+    int lo = 0, hi = NUM_WORDS - 1;
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        int c = strncmp(s, words[mid].word, n);
+        if (c == 0 && words[mid].word[n] != '\0')
+            c = -1; // s is a prefix of the word, so it sorts first
+        if (c == 0)
+            return &words[mid];
+        if (c < 0)
+            hi = mid - 1;
+        else
+            lo = mid + 1;
+    }
+    return NULL;
+}
+
+// Comma or space separated integers, as many as fit
+static int parse_args(const char *s, const char *end, int32_t *args)
+{
+    int n = 0;
+    while (s < end && n < PROTO_MAX_ARGS)
+    {
+        while (s < end && (*s == ' ' || *s == ','))
+            ++s;
+        bool neg = false;
+        if (s < end && (*s == '-' || *s == '+'))
+            neg = *s++ == '-';
+        if (s == end || *s < '0' || *s > '9')
+            break;
+        int32_t v = 0;
+        while (s < end && *s >= '0' && *s <= '9')
+            v = v * 10 + (*s++ - '0');
+        args[n++] = neg ? -v : v;
+    }
+    return n;
+}
+
+// Old style command string, "fwd100", "turncw", "setp1.5", "goto 500,200,90"
+bool proto_decode_text(const char *line, int len, proto_cmd *cmd)
+{
+    const char *end = line + len;
+    while (line < end && *line == ' ')
+        ++line;
+    int n = 0;
+    while (line + n < end && line[n] >= 'a' && line[n] <= 'z')
+        ++n;
+    memset(cmd, 0, sizeof(*cmd));
+
+    // set<gain><value>, the gain id may be a digit so it isn't part of the word
+    if (n >= 3 && strncmp(line, "set", 3) == 0)
+    {
+        if (end - line < 4)
+            return false;
+        cmd->op = PROTO_SET;
+        cmd->nargs = 2;
+        cmd->arg[0] = line[3];
+        cmd->arg[1] = q16_div_int(q16_parse(line + 4, end - line - 4), 10); // sent as tenths
+        return true;
+    }
+
+    const proto_word *w = find_word(line, n);
+    if (!w)
+        return false;
+    cmd->op = w->op;
+    if (w->op == PROTO_MISSION)
+    {
+        cmd->text = line + n;
+        cmd->text_len = end - line - n;
+        return true;
+    }
+    cmd->nargs = parse_args(line + n, end, cmd->arg);
+    if (cmd->nargs == 0 && w->has_default)
+    {
+        cmd->arg[0] = w->arg;
+        cmd->nargs = 1;
+    }
+    return true;
+}
+
+// frame is op followed by the arguments, as it follows the length byte
+bool proto_decode_frame(const uint8_t *frame, int len, proto_cmd *cmd)
+{
+    memset(cmd, 0, sizeof(*cmd));
+    if (len < 1 || frame[0] == PROTO_NONE || frame[0] >= PROTO_OP_COUNT)
+        return false;
+    cmd->op = frame[0];
+    if (cmd->op == PROTO_MISSION)
+    {
+        cmd->text = (const char *)frame + 1;
+        cmd->text_len = len - 1;
+        return true;
+    }
+    const uint8_t *a = frame + 1;
+    for (int i = 0; i < PROTO_MAX_ARGS && (i + 1) * 4 <= len - 1; ++i, a += 4)
+        cmd->arg[i] = a[0] | a[1] << 8 | a[2] << 16 | (uint32_t)a[3] << 24;
+    cmd->nargs = (len - 1) / 4 < PROTO_MAX_ARGS ? (len - 1) / 4 : PROTO_MAX_ARGS;
+    return true;
+}
+
+// Build a binary frame, out needs 3 + 4 * nargs bytes. Returns the frame length.
+int proto_encode(uint8_t *out, uint8_t op, const int32_t *args, int nargs)
+{
+    out[0] = PROTO_SYNC;
+    out[1] = 1 + 4 * nargs;
+    out[2] = op;
+    uint8_t *a = out + 3;
+    for (int i = 0; i < nargs; ++i, a += 4)
+    {
+        uint32_t v = args[i];
+        a[0] = v;
+        a[1] = v >> 8;
+        a[2] = v >> 16;
+        a[3] = v >> 24;
+    }
+    return 3 + 4 * nargs;
+}
+
+static int dispatch(proto_parser *pp, bool ok, const proto_cmd *cmd)
+{
+    if (!ok)
+    {
+        ++pp->stats.unknown;
+        return 0;
+    }
+    pp->handler(pp->ctx, cmd);
+    return 1;
+}
+
+static int dispatch_line(proto_parser *pp)
+{
+    proto_cmd cmd;
+    int len = pp->len;
+    while (len > 0 && pp->buf[len - 1] == '\r')
+        --len;
+    pp->buf[len] = '\0';
+    pp->len = 0;
+    pp->state = ST_IDLE;
+    ++pp->stats.lines;
+    return dispatch(pp, proto_decode_text((const char *)pp->buf, len, &cmd), &cmd);
+}
+
+// Feed received bytes, calls the handler for every complete command.
+// Returns the number of commands dispatched.
+int proto_feed(proto_parser *pp, const uint8_t *data, int len)
+{
+    const uint8_t *p = data, *end = data + len;
+    int handled = 0;
+    while (p < end)
+    {
+        switch (pp->state)
+        {
+        case ST_IDLE:
+        {
+            uint8_t b = *p++;
+            if (b == PROTO_SYNC)
+            {
+                pp->state = ST_LEN;
+            }
+            else if (b != '\n' && b != '\r' && b != '\0' && b != ' ')
+            {
+                pp->buf[0] = b;
+                pp->len = 1;
+                pp->state = ST_TEXT;
+            }
+            break;
+        }
+        case ST_LEN:
+            pp->need = *p++;
+            pp->len = 0;
+            if (pp->need == 0)
+            {
+                ++pp->stats.dropped;
+                pp->state = ST_IDLE;
+            }
+            else
+            {
+                pp->state = ST_BODY;
+            }
+            break;
+        case ST_BODY:
+        {
+            int n = end - p < pp->need ? end - p : pp->need;
+            memcpy(pp->buf + pp->len, p, n);
+            p += n;
+            pp->len += n;
+            pp->need -= n;
+            if (pp->need == 0)
+            {
+                proto_cmd cmd;
+                ++pp->stats.frames;
+                pp->state = ST_IDLE;
+                handled += dispatch(pp, proto_decode_frame(pp->buf, pp->len, &cmd), &cmd);
+            }
+            break;
+        }
+        case ST_TEXT:
+        case ST_SKIP:
+        {
+            const uint8_t *eol = p;
+            while (eol < end && *eol != '\n' && *eol != '\0')
+                ++eol;
+            int n = eol - p;
+            if (pp->state == ST_TEXT && pp->len + n > PROTO_MAX_FRAME)
+            {
+                ++pp->stats.dropped;
+                pp->state = ST_SKIP;
+            }
+            if (pp->state == ST_TEXT)
+            {
+                memcpy(pp->buf + pp->len, p, n);
+                pp->len += n;
+            }
+            p = eol;
+            if (p < end)
+            {
+                ++p;
+                if (pp->state == ST_TEXT)
+                    handled += dispatch_line(pp);
+                pp->state = ST_IDLE;
+                pp->len = 0;
+            }
+            break;
+        }
+        }
+    }
+    return handled;
+}
+
+// End of a TCP segment: take an unterminated text line as complete.
+// A binary frame split across segments is kept until the rest arrives.
+int proto_end_segment(proto_parser *pp)
+{
+    int handled = 0;
+    if (pp->state == ST_TEXT && pp->len > 0)
+        handled = dispatch_line(pp);
+    else if (pp->state == ST_SKIP)
+        pp->state = ST_IDLE;
+    return handled;
+}
@@ -0,0 +1,84 @@
+#ifndef proto_h
+#define proto_h
+#include <stdint.h>
+#include <stdbool.h>
+
+// Command channel framing. A TCP stream carries any mix of
+//   binary frames: 0xA5, len, op, args...   len counts op + args (1..255),
+//                  args are little endian int32, except PROTO_MISSION which carries text
+//   text lines:    "fwd100\n", the old command strings, ended by '\n' or '\0'
+// Frames are reassembled across pbufs and segments. A text line still open at
+// the end of a segment is taken as complete, older clients send one command
+// per segment without a newline.
+
+#define PROTO_SYNC 0xA5
+#define PROTO_MAX_FRAME 255
+#define PROTO_MAX_ARGS 4
+
+typedef enum proto_op_ {
+    PROTO_NONE,
+    PROTO_START,
+    PROTO_STOP,
+    PROTO_TURN,     // degrees, + clockwise
+    PROTO_FWD,      // edges, -1 cancels
+    PROTO_BAR,      // edges, 200 if omitted
+    PROTO_ARC,      // radius mm, degrees
+    PROTO_GOTO,     // x mm, y mm[, heading]
+    PROTO_SET,      // gain id char, Q16.16 value
+    PROTO_RATE,     // control loop hz
+    PROTO_RESET,
+    PROTO_MISSION,  // mission text, see mission.h
+    PROTO_TELEOP,
+    PROTO_BENCH,    // 0 fixed point, 1 interrupt latency
+    PROTO_CHAR,
+    PROTO_FFTABLE,
+    PROTO_JITTER,
+    PROTO_CMDSTATS,
+    PROTO_POSE,
+    PROTO_NETSTATS,
+    PROTO_SUB,      // SERVER_STREAM_ mask, reports the mask if omitted
+    PROTO_STREAM,   // udp port, hz[, samples per datagram[, delta]], port 0 stops
+    PROTO_TLM,      // telemetry stream, hz, reports the rates if omitted
+    PROTO_TRACE,    // 0 status, 1 start, 2 stop, 3 dump, see trace.h
+    PROTO_STATS,    // binary per task CPU, stack and heap, see taskstats.h
+    PROTO_ISR,      // GPIO interrupt rates and histograms, 1 also resets them
+    PROTO_OP_COUNT
+} proto_op;
+
+// One decoded command, text points into the parser buffer and is only valid
+// during the handler call
+typedef struct proto_cmd_ {
+    uint8_t op;
+    uint8_t nargs;
+    int32_t arg[PROTO_MAX_ARGS];
+    const char *text;
+    int text_len;
+} proto_cmd;
+
+typedef void (*proto_handler)(void *ctx, const proto_cmd *cmd);
+
+typedef struct proto_stats_ {
+    uint32_t frames;
+    uint32_t lines;
+    uint32_t unknown;  // decoded to no known command
+    uint32_t dropped;  // bad length byte or overlong text line
+} proto_stats;
+
+typedef struct proto_parser_ {
+    uint8_t state;
+    uint8_t need;   // frame bytes still to come
+    uint16_t len;   // bytes held in buf
+    uint8_t buf[PROTO_MAX_FRAME + 1];
+    proto_handler handler;
+    void *ctx;
+    proto_stats stats;
+} proto_parser;
+
+void proto_init(proto_parser *pp, proto_handler handler, void *ctx);
+int proto_feed(proto_parser *pp, const uint8_t *data, int len);
+int proto_end_segment(proto_parser *pp);
+bool proto_decode_text(const char *line, int len, proto_cmd *cmd);
+bool proto_decode_frame(const uint8_t *frame, int len, proto_cmd *cmd);
+int proto_encode(uint8_t *out, uint8_t op, const int32_t *args, int nargs);
+
+#endif
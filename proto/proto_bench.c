@@ -0,0 +1,179 @@
+// Host benchmark for the command parser, not part of the firmware build.
+//   cc -O2 -Iproto -Ifixedpoint proto/proto_bench.c proto/proto.c fixedpoint/fixed.c -o proto_bench
+// Compares the old strncmp chain (one command per segment) with proto_feed on
+// text lines and on binary frames split at random points like pbuf chains.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "proto.h"
+#include "fixed.h"
+
+#define NUM_CMDS 200000
+
+static const char *samples[] = {
+    "fwd100", "turncw", "stop", "setp1.5", "bar", "rate500", "turnccw", "goto 500,200,90", "arc 300,90", "pose",
+};
+#define NUM_SAMPLES (sizeof(samples) / sizeof(samples[0]))
+
+static volatile int32_t sink;
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// the chain tcp_server_recv used to run on every segment
+static void legacy_dispatch(const char *payload)
+{
+    char value[8] = "";
+    if (strncmp(payload, "start", 5) == 0)
+        sink += 1;
+    if (strncmp(payload, "turncw", 6) == 0)
+        sink += 90;
+    if (strncmp(payload, "turnccw", 7) == 0)
+        sink -= 90;
+    if (strncmp(payload, "stop", 4) == 0)
+        sink += 2;
+    if (strncmp(payload, "set", 3) == 0)
+    {
+        strncpy(value, payload + 4, 4);
+        sink += q16_parse(value, 4);
+    }
+    if (strncmp(payload, "fwd", 3) == 0)
+    {
+        strncpy(value, payload + 3, 4);
+        sink += atoi(value);
+    }
+    if (strncmp(payload, "bar", 3) == 0)
+        sink += 200;
+    if (strncmp(payload, "bench", 5) == 0)
+        sink += 3;
+    if (strncmp(payload, "char", 4) == 0)
+        sink += 4;
+    if (strncmp(payload, "fftable", 7) == 0)
+        sink += 5;
+    if (strncmp(payload, "rate", 4) == 0)
+    {
+        strncpy(value, payload + 4, 4);
+        sink += atoi(value);
+    }
+    if (strncmp(payload, "jitter", 6) == 0)
+        sink += 6;
+    if (strncmp(payload, "mission", 7) == 0)
+        sink += 7;
+    if (strncmp(payload, "teleop", 6) == 0)
+        sink += 8;
+    if (strncmp(payload, "arc", 3) == 0)
+    {
+        char *end;
+        sink += strtol(payload + 3, &end, 10);
+        sink += strtol(end + (*end == ','), NULL, 10);
+    }
+    if (strncmp(payload, "goto", 4) == 0)
+    {
+        char *end;
+        sink += strtol(payload + 4, &end, 10);
+        sink += strtol(end + (*end == ','), &end, 10);
+        if (*end == ',')
+            sink += strtol(end + 1, NULL, 10);
+    }
+    if (strncmp(payload, "pose", 4) == 0)
+        sink += 9;
+    if (strncmp(payload, "cmdstats", 8) == 0)
+        sink += 10;
+    if (strncmp(payload, "reset", 5) == 0)
+        sink += 11;
+}
+
+static void count_cmd(void *ctx, const proto_cmd *cmd)
+{
+    ++*(int *)ctx;
+    sink += cmd->op + cmd->arg[0];
+}
+
+static void report(const char *name, double ns, int cmds, long bytes)
+{
+    printf("%-28s %8.1f ns/cmd %8.2f Mcmd/s %6.1f B/cmd\n", name, ns / cmds, cmds / ns * 1e3, (double)bytes / cmds);
+}
+
+// feed in random sized chunks, 1..max bytes, the way a pbuf chain splits a stream
+static int feed_chunked(proto_parser *pp, const uint8_t *buf, long len, int max)
+{
+    int handled = 0;
+    long off = 0;
+    srand(1);
+    while (off < len)
+    {
+        int n = 1 + rand() % max;
+        if (n > len - off)
+            n = len - off;
+        handled += proto_feed(pp, buf + off, n);
+        off += n;
+    }
+    return handled;
+}
+
+int main(void)
+{
+    // legacy, one command per segment
+    double t0 = now_ns();
+    long legacy_bytes = 0;
+    for (int i = 0; i < NUM_CMDS; ++i)
+    {
+        legacy_dispatch(samples[i % NUM_SAMPLES]);
+        legacy_bytes += strlen(samples[i % NUM_SAMPLES]) + 1;
+    }
+    report("strncmp chain", now_ns() - t0, NUM_CMDS, legacy_bytes);
+
+    // text lines, many per segment
+    long text_len = 0;
+    for (int i = 0; i < NUM_CMDS; ++i)
+        text_len += strlen(samples[i % NUM_SAMPLES]) + 1;
+    char *text = malloc(text_len);
+    char *w = text;
+    for (int i = 0; i < NUM_CMDS; ++i)
+    {
+        int n = strlen(samples[i % NUM_SAMPLES]);
+        memcpy(w, samples[i % NUM_SAMPLES], n);
+        w[n] = '\n';
+        w += n + 1;
+    }
+    int handled = 0;
+    proto_parser pp;
+    proto_init(&pp, count_cmd, &handled);
+    t0 = now_ns();
+    feed_chunked(&pp, (const uint8_t *)text, text_len, 1460);
+    report("proto text lines", now_ns() - t0, handled, text_len);
+
+    // binary frames, same commands
+    proto_cmd decoded[NUM_SAMPLES];
+    for (int i = 0; i < NUM_SAMPLES; ++i)
+        proto_decode_text(samples[i], strlen(samples[i]), &decoded[i]);
+    uint8_t *frames = malloc((long)NUM_CMDS * (3 + 4 * PROTO_MAX_ARGS));
+    long frames_len = 0;
+    for (int i = 0; i < NUM_CMDS; ++i)
+    {
+        const proto_cmd *c = &decoded[i % NUM_SAMPLES];
+        frames_len += proto_encode(frames + frames_len, c->op, c->arg, c->nargs);
+    }
+    handled = 0;
+    proto_init(&pp, count_cmd, &handled);
+    t0 = now_ns();
+    feed_chunked(&pp, frames, frames_len, 1460);
+    report("proto binary frames", now_ns() - t0, handled, frames_len);
+
+    // worst case split, every byte its own pbuf
+    handled = 0;
+    proto_init(&pp, count_cmd, &handled);
+    t0 = now_ns();
+    feed_chunked(&pp, frames, frames_len, 1);
+    report("proto binary, 1 byte chunks", now_ns() - t0, handled, frames_len);
+
+    printf("dropped %u unknown %u\n", pp.stats.dropped, pp.stats.unknown);
+    free(text);
+    free(frames);
+    return 0;
+}
@@ -0,0 +1,355 @@
+#include "FreeRTOS.h"
+#include "pico/stdlib.h"
+#include "Server.h"
+#include "motor.h"
+#include "fixed.h"
+#include "looptimer.h"
+#include "command.h"
+#include "mission.h"
+#include "teleop.h"
+#include "stream.h"
+#include "telemetry.h"
+#include "logging.h"
+#include "trace.h"
+#include "isrstats.h"
+#include "taskstats.h"
+#include "drive.h"
+#include "feedforward.h"
+#include "odometry.h"
+#include "proto.h"
+#include "move.h"
+#include "remote.h"
+
+// one parser per connection, a command split across segments must not mix with another client's
+static proto_parser parsers[SERVER_MAX_CLIENTS];
+static proto_stats closed_stats; // connections whose parser has since been reused
+static server_client *reply_to; // client whose command is being handled
+
+static void send_report(const char *report, int len, int size)
+{
+    server_reply(reply_to, report, MIN(len + 1, size));
+}
+
+static void on_start(const proto_cmd *cmd)
+{
+    LOG("starting\n");
+}
+
+static void on_stop(const proto_cmd *cmd)
+{
+    command_post(CMD_STOP, 0, 0);
+}
+
+static void on_turn(const proto_cmd *cmd)
+{
+    LOG("turn %ld\n", cmd->arg[0]);
+    command_post(CMD_TURN, cmd->arg[0], 0);
+}
+
+static void on_fwd(const proto_cmd *cmd)
+{
+    command_post(CMD_FWD, cmd->arg[0], 0);
+}
+
+static void on_bar(const proto_cmd *cmd)
+{
+    command_post(CMD_BAR, cmd->nargs ? cmd->arg[0] : 200, 0);
+}
+
+// + degrees is clockwise
+static void on_arc(const proto_cmd *cmd)
+{
+    command_post(CMD_ARC, cmd->arg[0], cmd->arg[1]);
+}
+
+// x, y in the odometry frame, see "pose"
+static void on_goto(const proto_cmd *cmd)
+{
+    move_cmd goto_cmd = {.op = CMD_GOTO, .arg = {cmd->arg[0], cmd->arg[1], CMD_NO_HEADING}};
+    if (cmd->nargs > 2)
+        goto_cmd.arg[2] = cmd->arg[2];
+    command_post_cmd(&goto_cmd);
+}
+
+static void on_set(const proto_cmd *cmd)
+{
+    q16_t value = cmd->arg[1];
+    LOG("set %c " Q16_FMT "\n", (char)cmd->arg[0], Q16_ARGS(value));
+    switch (cmd->arg[0])
+    {
+    case 'p':
+        tkp = value;
+        break;
+    case 'i':
+        tki = value;
+        break;
+    case 'd':
+        tkd = value;
+        break;
+    case '1':
+        fkp = value;
+        break;
+    case '2':
+        fki = value;
+        break;
+    case '3':
+        fkd = value;
+        break;
+    case 'v':
+        drive_kp = value;
+        break;
+    case 'w':
+        drive_ki = value;
+        break;
+    case 's':
+        drive_ksync = value;
+        break;
+    }
+}
+
+static void on_rate(const proto_cmd *cmd)
+{
+    // the position loop runs at rate / CASCADE_OUTER_DIV, it needs at least 1Hz
+    if (cmd->arg[0] < CASCADE_OUTER_DIV || !looptimer_set_rate(cmd->arg[0]))
+        LOG("rate must be %d-%d hz\n", CASCADE_OUTER_DIV, LOOPTIMER_MAX_HZ);
+}
+
+static void on_reset(const proto_cmd *cmd)
+{
+    reset_wheel_encoder();
+    odom_reset();
+}
+
+// e.g. "mission fwd100;turn90;bar;wait;fwd50"
+static void on_mission(const proto_cmd *cmd)
+{
+    if (mission_load(cmd->text, cmd->text_len) > 0)
+        command_post(CMD_MISSION, 0, 0);
+    else
+        server_reply(reply_to, "bad mission\n", 13);
+}
+
+static void on_teleop(const proto_cmd *cmd)
+{
+    char report[100] = "";
+    send_report(report, teleop_report(report, sizeof(report)), sizeof(report));
+    command_post(CMD_TELEOP, 0, 0);
+}
+
+// "bench" fixed point, "bench 1" interrupt latency, see irqbench.h
+static void on_bench(const proto_cmd *cmd)
+{
+    command_post(CMD_BENCH, cmd->nargs ? cmd->arg[0] : 0, 0);
+}
+
+static void on_char(const proto_cmd *cmd)
+{
+    command_post(CMD_CHAR, 0, 0);
+}
+
+static void on_fftable(const proto_cmd *cmd)
+{
+    char report[100] = "";
+    int len;
+    for (int line = 0; (len = ff_report(report, sizeof(report), line)) > 0; ++line)
+        send_report(report, len, sizeof(report));
+}
+
+static void on_jitter(const proto_cmd *cmd)
+{
+    char report[100] = "";
+    int len;
+    for (int line = 0; (len = looptimer_report(report, sizeof(report), line)) > 0; ++line)
+        send_report(report, len, sizeof(report));
+}
+
+// "isr 1" starts the histograms over after reporting them
+static void on_isr(const proto_cmd *cmd)
+{
+    char report[100] = "";
+    int len;
+    for (int line = 0; (len = isrstats_report(report, sizeof(report), line)) > 0; ++line)
+        send_report(report, len, sizeof(report));
+    if (cmd->nargs && cmd->arg[0] == 1)
+        isrstats_reset();
+}
+
+static void on_cmdstats(const proto_cmd *cmd)
+{
+    char report[100] = "";
+    send_report(report, command_report(report, sizeof(report)), sizeof(report));
+    send_report(report, remote_report(report, sizeof(report)), sizeof(report));
+    send_report(report, log_report(report, sizeof(report)), sizeof(report));
+}
+
+static void on_pose(const proto_cmd *cmd)
+{
+    char report[100] = "";
+    send_report(report, odom_report(report, sizeof(report)), sizeof(report));
+}
+
+static void on_netstats(const proto_cmd *cmd)
+{
+    char report[100] = "";
+    int len;
+    for (int line = 0; (len = server_tx_report(report, sizeof(report), line)) > 0; ++line)
+        send_report(report, len, sizeof(report));
+}
+
+// e.g. "sub 3" for PID lines and events only, see SERVER_STREAM_ in Server.h. No argument reports the mask.
+static void on_sub(const proto_cmd *cmd)
+{
+    char report[100] = "";
+    if (cmd->nargs)
+        server_subscribe(reply_to, cmd->arg[0]);
+    send_report(report, snprintf(report, sizeof(report), "[SUB]id:%d\tmask:%lx\n", reply_to->id, reply_to->subscriptions), sizeof(report));
+}
+
+// e.g. "stream 4244,200" sends samples to this client's address, "stream 4244,200,4,1"
+// four delta encoded samples a datagram, see stream.h.
+// "stream 0" stops, no arguments only reports.
+static void on_stream(const proto_cmd *cmd)
+{
+    char report[100] = "";
+    if (cmd->nargs == 1 && cmd->arg[0] == 0)
+        stream_stop();
+    else if (cmd->nargs >= 2 && !stream_set(&reply_to->pcb->remote_ip, cmd->arg[0], cmd->arg[1],
+                                            cmd->nargs > 2 ? cmd->arg[2] : 1, cmd->nargs > 3 ? cmd->arg[3] : STREAM_RAW))
+        server_reply(reply_to, "bad stream\n", 12);
+    send_report(report, stream_report(report, sizeof(report)), sizeof(report));
+}
+
+// e.g. "tlm 3,20" for encoder reports at 20Hz, see telemetry.h for the stream numbers
+static void on_tlm(const proto_cmd *cmd)
+{
+    char report[100] = "";
+    if (cmd->nargs >= 2 && !telemetry_set_rate(cmd->arg[0], cmd->arg[1]))
+        server_reply(reply_to, "bad tlm\n", 9);
+    send_report(report, telemetry_report(report, sizeof(report)), sizeof(report));
+}
+
+// "tracedump" sends "[TRC]bytes:N" and N bytes of binary dump to this client,
+// nothing else goes to it meanwhile. Send "sub 0" first, trace/trace2json.c does.
+static void on_trace(const proto_cmd *cmd)
+{
+    char report[100] = "";
+    switch (cmd->nargs ? cmd->arg[0] : 0)
+    {
+    case 1:
+        trace_start();
+        break;
+    case 2:
+        trace_stop();
+        break;
+    case 3:
+        if (trace_dump_begin())
+        {
+            if (server_attach_bulk(reply_to, trace_dump_fill, NULL))
+                return;
+            trace_dump_fill(NULL, NULL, 0);
+        }
+        server_reply(reply_to, "trace busy\n", 12);
+        break;
+    }
+    send_report(report, trace_report(report, sizeof(report)), sizeof(report));
+}
+
+// "[STA]bytes:N" and N bytes, see stats_format.h and stats/stats_recv.c
+static void on_stats(const proto_cmd *cmd)
+{
+    if (taskstats_begin())
+    {
+        if (server_attach_bulk(reply_to, taskstats_fill, NULL))
+            return;
+        taskstats_fill(NULL, NULL, 0);
+    }
+    server_reply(reply_to, "stats busy\n", 12);
+}
+
+static void (*const handlers[PROTO_OP_COUNT])(const proto_cmd *) = {
+    [PROTO_START] = on_start,
+    [PROTO_STOP] = on_stop,
+    [PROTO_TURN] = on_turn,
+    [PROTO_FWD] = on_fwd,
+    [PROTO_BAR] = on_bar,
+    [PROTO_ARC] = on_arc,
+    [PROTO_GOTO] = on_goto,
+    [PROTO_SET] = on_set,
+    [PROTO_RATE] = on_rate,
+    [PROTO_RESET] = on_reset,
+    [PROTO_MISSION] = on_mission,
+    [PROTO_TELEOP] = on_teleop,
+    [PROTO_BENCH] = on_bench,
+    [PROTO_CHAR] = on_char,
+    [PROTO_FFTABLE] = on_fftable,
+    [PROTO_JITTER] = on_jitter,
+    [PROTO_CMDSTATS] = on_cmdstats,
+    [PROTO_POSE] = on_pose,
+    [PROTO_NETSTATS] = on_netstats,
+    [PROTO_SUB] = on_sub,
+    [PROTO_STREAM] = on_stream,
+    [PROTO_TLM] = on_tlm,
+    [PROTO_TRACE] = on_trace,
+    [PROTO_STATS] = on_stats,
+    [PROTO_ISR] = on_isr,
+};
+
+static void dispatch(void *ctx, const proto_cmd *cmd)
+{
+    reply_to = ctx;
+    trace_event(TRACE_COMMAND, cmd->op, cmd->nargs ? cmd->arg[0] : 0);
+    handlers[cmd->op](cmd);
+}
+
+void remote_init(void)
+{
+    for (int i = 0; i < SERVER_MAX_CLIENTS; ++i)
+        proto_init(&parsers[i], dispatch, NULL);
+}
+
+static void stats_add(proto_stats *total, const proto_stats *s)
+{
+    total->frames += s->frames;
+    total->lines += s->lines;
+    total->unknown += s->unknown;
+    total->dropped += s->dropped;
+}
+
+// new connection in this slot, drop whatever the last one left half parsed
+// and keep its counts for the totals
+void tcp_server_opened(server_client *client)
+{
+    stats_add(&closed_stats, &parsers[client->id].stats);
+    proto_init(&parsers[client->id], dispatch, client);
+}
+
+// totals over every connection since boot
+int remote_report(char *out, int len)
+{
+    proto_stats total = closed_stats;
+    for (int i = 0; i < SERVER_MAX_CLIENTS; ++i)
+        stats_add(&total, &parsers[i].stats);
+    return snprintf(out, len, "[PRO]frames:%lu\tlines:%lu\tunknown:%lu\tdropped:%lu\n",
+                    total.frames, total.lines, total.unknown, total.dropped);
+}
+
+err_t tcp_server_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{ // Receive data from the TCP connection.
+    server_client *client = arg;
+    if (!p)
+    { // The client closed its end, free the slot for the next one.
+        return server_close(client);
+    }
+    if (p->tot_len > 0)
+    {
+        // walk the whole chain, a segment can span several pbufs
+        proto_parser *parser = &parsers[client->id];
+        for (struct pbuf *q = p; q != NULL; q = q->next)
+            proto_feed(parser, q->payload, q->len);
+        proto_end_segment(parser);
+        tcp_recved(tpcb, p->tot_len); // reopen the receive window
+        server_reply(client, "ack\n", 5);
+    }
+    pbuf_free(p); // Free the packet buffer.
+    return ERR_OK;
+}
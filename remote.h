@@ -0,0 +1,10 @@
+#ifndef remote_h
+#define remote_h
+
+// Command channel: decodes proto frames and text commands from the TCP
+// server and hands each one to its handler through a table indexed by opcode.
+
+void remote_init(void);
+int remote_report(char *out, int len);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef stats_format_h
+#define stats_format_h
+#include <stdint.h>
+
+// "stats" reply layout, shared by the firmware and stats_recv. The text line
+// "[STA]bytes:N\n" is followed by N bytes, little endian:
+//   stats_header
+//   tasks * stats_task
+
+#define STATS_MAGIC 0x5453 // "ST"
+#define STATS_VERSION 1
+#define STATS_NAME_LEN 12
+#define STATS_CPU_UNKNOWN 0xffff
+
+typedef struct __attribute__((packed)) stats_header_ {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t tasks;
+    uint32_t window_us;  // CPU shares are over this, the time since the last "stats" or boot
+    uint32_t uptime_us;  // wraps after 71 minutes
+    uint32_t heap_total;
+    uint32_t heap_free;
+    uint32_t heap_min;   // lowest free heap since boot
+} stats_header;
+
+typedef struct __attribute__((packed)) stats_task_ {
+    uint8_t number;
+    uint8_t priority;
+    uint8_t state;          // eTaskState, 0 running 1 ready 2 blocked 3 suspended 4 deleted
+    uint16_t cpu_permille;  // of window_us, STATS_CPU_UNKNOWN past the task numbers tracked
+    uint16_t stack_free;    // words never used since the task started
+    uint32_t runtime_us;    // total, wraps with uptime_us
+    char name[STATS_NAME_LEN];
+} stats_task;
+
+#endif
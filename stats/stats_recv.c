@@ -0,0 +1,128 @@
+// Host tool, not part of the firmware build. Asks the car for "stats" and
+// prints the per task CPU share, stack and heap.
+//   cc -O2 -Istats stats/stats_recv.c -o stats_recv
+//   ./stats_recv <car ip> [port] [seconds]
+// Port 4242 by default. With seconds it asks again at that interval, like top,
+// each table then covers the time since the one before.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include "stats_format.h"
+
+static const char *const states[] = {"run", "ready", "blocked", "susp", "deleted", "invalid"};
+
+static int connect_car(const char *host, const char *port)
+{
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM}, *ai;
+    if (getaddrinfo(host, port, &hints, &ai) != 0)
+    {
+        fprintf(stderr, "can't resolve %s\n", host);
+        return -1;
+    }
+    int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0 || connect(fd, ai->ai_addr, ai->ai_addrlen) < 0)
+    {
+        perror("connect");
+        return -1;
+    }
+    freeaddrinfo(ai);
+    // telemetry would land between the replies
+    if (write(fd, "sub 0\n", 6) < 0)
+    {
+        perror("write");
+        return -1;
+    }
+    return fd;
+}
+
+// Skip text replies, ending in "\n\0", up to "[STA]bytes:N". Returns N, -1 on error.
+static long read_dump_line(FILE *f)
+{
+    char line[256];
+    int n = 0, c;
+    while ((c = fgetc(f)) != EOF)
+    {
+        if (c == '\0')
+            continue;
+        if (c != '\n' && n < (int)sizeof(line) - 1)
+        {
+            line[n++] = c;
+            continue;
+        }
+        line[n] = '\0';
+        n = 0;
+        if (strncmp(line, "[STA]bytes:", 11) == 0)
+            return atol(line + 11);
+        if (strcmp(line, "stats busy") == 0)
+            return -1;
+    }
+    return -1;
+}
+
+static int print_stats(const uint8_t *buf, long bytes)
+{
+    stats_header h;
+    if (bytes < (long)sizeof(h))
+        return -1;
+    memcpy(&h, buf, sizeof(h));
+    if (h.magic != STATS_MAGIC || h.version != STATS_VERSION || bytes != (long)(sizeof(h) + h.tasks * sizeof(stats_task)))
+    {
+        fprintf(stderr, "not a stats reply\n");
+        return -1;
+    }
+    printf("uptime %.1fs  window %.3fs  heap %u free, %u min ever of %u\n",
+           h.uptime_us / 1e6, h.window_us / 1e6, h.heap_free, h.heap_min, h.heap_total);
+    printf("%3s  %-12s %4s %-8s %7s %10s %11s\n", "#", "task", "prio", "state", "cpu", "stack free", "runtime s");
+    for (int i = 0; i < h.tasks; ++i)
+    {
+        stats_task t;
+        memcpy(&t, buf + sizeof(h) + i * sizeof(t), sizeof(t));
+        char name[STATS_NAME_LEN + 1] = "", cpu[16] = "-";
+        memcpy(name, t.name, STATS_NAME_LEN);
+        if (t.cpu_permille != STATS_CPU_UNKNOWN)
+            snprintf(cpu, sizeof(cpu), "%.1f%%", t.cpu_permille / 10.0);
+        printf("%3u  %-12s %4u %-8s %7s %10u %11.3f\n", t.number, name, t.priority,
+               states[t.state < 5 ? t.state : 5], cpu, t.stack_free, t.runtime_us / 1e6);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <host> [port] [seconds]\n", argv[0]);
+        return 2;
+    }
+    int fd = connect_car(argv[1], argc > 2 ? argv[2] : "4242");
+    if (fd < 0)
+        return 1;
+    FILE *f = fdopen(fd, "rb");
+    int interval = argc > 3 ? atoi(argv[3]) : 0;
+    do
+    {
+        if (write(fd, "stats\n", 6) < 0)
+            return 1;
+        long bytes = read_dump_line(f);
+        if (bytes < 0)
+        {
+            fprintf(stderr, "no stats reply\n");
+            return 1;
+        }
+        uint8_t *buf = malloc(bytes);
+        if (fread(buf, 1, bytes, f) != (size_t)bytes || print_stats(buf, bytes) != 0)
+            return 1;
+        free(buf);
+        if (interval)
+        {
+            printf("\n");
+            fflush(stdout);
+            sleep(interval);
+        }
+    } while (interval);
+    return 0;
+}
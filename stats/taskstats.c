@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <string.h>
+#include "hardware/sync.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "taskstats.h"
+
+// run time of each task number at the last snapshot, task numbers count up
+// from 1 at creation. The first snapshot's window is the time since boot.
+static uint32_t prev_runtime[STATS_MAX_TASKS * 2];
+static uint32_t prev_total;
+
+static struct {
+    bool busy;
+    uint8_t buf[24 + sizeof(stats_header) + STATS_MAX_TASKS * sizeof(stats_task)];
+    int len, sent;
+} reply;
+
+// Claim the reply, false while the last one is still being sent
+bool taskstats_begin(void)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    bool ok = !reply.busy;
+    if (ok)
+    {
+        reply.busy = true;
+        reply.len = 0;
+    }
+    restore_interrupts(irq);
+    return ok;
+}
+
+// "[STA]bytes:N" line and the binary snapshot, see stats_format.h
+static void snapshot(void)
+{
+    static TaskStatus_t status[STATS_MAX_TASKS];
+    uint32_t total;
+    UBaseType_t tasks = uxTaskGetSystemState(status, STATS_MAX_TASKS, &total);
+    stats_header h = {
+        .magic = STATS_MAGIC,
+        .version = STATS_VERSION,
+        .tasks = tasks,
+        .window_us = total - prev_total,
+        .uptime_us = total,
+        .heap_total = configTOTAL_HEAP_SIZE,
+        .heap_free = xPortGetFreeHeapSize(),
+        .heap_min = xPortGetMinimumEverFreeHeapSize(),
+    };
+    int n = snprintf((char *)reply.buf, 24, "[STA]bytes:%u\n", sizeof(h) + tasks * sizeof(stats_task));
+    memcpy(reply.buf + n, &h, sizeof(h));
+    n += sizeof(h);
+    for (UBaseType_t i = 0; i < tasks; ++i)
+    {
+        const TaskStatus_t *s = &status[i];
+        stats_task t = {
+            .number = s->xTaskNumber,
+            .priority = s->uxCurrentPriority,
+            .state = s->eCurrentState,
+            .cpu_permille = STATS_CPU_UNKNOWN,
+            .stack_free = s->usStackHighWaterMark,
+            .runtime_us = s->ulRunTimeCounter,
+        };
+        if (s->xTaskNumber < STATS_MAX_TASKS * 2)
+        {
+            uint32_t ran = s->ulRunTimeCounter - prev_runtime[s->xTaskNumber];
+            if (h.window_us != 0)
+                t.cpu_permille = (uint64_t)ran * 1000 / h.window_us;
+            prev_runtime[s->xTaskNumber] = s->ulRunTimeCounter;
+        }
+        strncpy(t.name, s->pcTaskName, STATS_NAME_LEN);
+        memcpy(reply.buf + n, &t, sizeof(t));
+        n += sizeof(t);
+    }
+    prev_total = total;
+    reply.len = n;
+    reply.sent = 0;
+}
+
+// Bulk source for server_attach_bulk, takes the snapshot on the first call.
+// Returns 0 once it is sent, out NULL cancels.
+int taskstats_fill(__unused void *ctx, uint8_t *out, int len)
+{
+    if (!reply.busy)
+        return 0;
+    if (out == NULL)
+    {
+        reply.busy = false;
+        return 0;
+    }
+    if (reply.len == 0)
+        snapshot();
+    int n = MIN(len, reply.len - reply.sent);
+    memcpy(out, reply.buf + reply.sent, n);
+    reply.sent += n;
+    if (n == 0)
+        reply.busy = false;
+    return n;
+}
@@ -0,0 +1,20 @@
+#ifndef taskstats_h
+#define taskstats_h
+#include "pico/stdlib.h"
+#include "stats_format.h"
+
+// Per task CPU share, stack high water and heap, for capacity planning.
+// FreeRTOS counts each task's run time in microseconds of the RP2040 timer
+// (configGENERATE_RUN_TIME_STATS), a snapshot compares it with the previous
+// one. lwIP and the other IRQs run on whichever task they interrupted and
+// are counted against it, IDLE is the CPU left over.
+//
+// The snapshot has to be taken in task context, the "stats" command pulls it
+// through server_attach_bulk so ServerTxTask takes it.
+
+#define STATS_MAX_TASKS 16
+
+bool taskstats_begin(void);
+int taskstats_fill(void *ctx, uint8_t *out, int len);
+
+#endif
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <string.h>
+#include "FreeRTOS.h"
+#include "task.h"
+#include "pico/stdlib.h"
+#include "Server.h"
+#include "motor.h"
+#include "move.h"
+#include "telemetry.h"
+
+static const char *const names[TLM_COUNT] = {
+    [TLM_PID] = "pid",
+    [TLM_EVENTS] = "evt",
+    [TLM_CAL] = "cal",
+    [TLM_ENCODERS] = "enc",
+    [TLM_BEARING] = "brg",
+    [TLM_ULTRASONIC] = "us",
+    [TLM_BARCODE] = "bar",
+    [TLM_TASKS] = "tsk",
+    [TLM_LOG] = "log",
+};
+
+// PID keeps the 1Hz it was hardcoded at. Calibration ran every 2s, the
+// integer Hz table can't express that so it reports at 1Hz now.
+static uint32_t rate_hz[TLM_COUNT] = {[TLM_PID] = 1, [TLM_CAL] = 1};
+static uint32_t next_us[TLM_COUNT];
+
+// written by move_task and sense_task, emptied by telemetry_poll in sense_task
+static tlm_agg left_speed, right_speed, bearing, ultrasonic;
+static int bearing_ref; // bearing window is kept relative to its first sample, it wraps at 360
+
+static void agg_add(tlm_agg *a, int32_t v)
+{
+    taskENTER_CRITICAL();
+    if (a->n == 0 || v < a->min)
+        a->min = v;
+    if (a->n == 0 || v > a->max)
+        a->max = v;
+    a->sum += v;
+    a->last = v;
+    ++a->n;
+    taskEXIT_CRITICAL();
+}
+
+// copy and restart the window, a window with no samples repeats the last value
+static tlm_agg agg_take(tlm_agg *a)
+{
+    taskENTER_CRITICAL();
+    tlm_agg out = *a;
+    a->n = 0;
+    a->sum = 0;
+    taskEXIT_CRITICAL();
+    if (out.n == 0)
+    {
+        out.min = out.max = out.sum = out.last;
+        out.n = 1;
+    }
+    return out;
+}
+
+static int32_t agg_mean(const tlm_agg *a)
+{
+    return a->sum / (int32_t)a->n;
+}
+
+bool telemetry_set_rate(tlm_stream stream, uint32_t hz)
+{
+    if (stream >= TLM_COUNT || hz > TLM_MAX_HZ)
+        return false;
+    rate_hz[stream] = hz;
+    next_us[stream] = time_us_32();
+    return true;
+}
+
+// some connected client subscribes to the stream
+bool telemetry_wanted(tlm_stream stream)
+{
+    return server_subscribed() & (1u << stream);
+}
+
+// Rate gate for a stream, true at most rate_hz times a second
+bool telemetry_due(tlm_stream stream)
+{
+    uint32_t hz = rate_hz[stream];
+    if (hz == 0 || !telemetry_wanted(stream))
+        return false;
+    uint32_t now = time_us_32();
+    if ((int32_t)(now - next_us[stream]) < 0)
+        return false;
+    next_us[stream] += 1000000 / hz;
+    if ((int32_t)(now - next_us[stream]) >= 0) // behind by a whole period, don't burst to catch up
+        next_us[stream] = now + 1000000 / hz;
+    return true;
+}
+
+// Format once, fan out to every client subscribed to the stream
+void telemetry_publish(tlm_stream stream, const char *line)
+{
+    server_publish(1u << stream, line, strlen(line) + 1);
+}
+
+// every inner loop tick
+void telemetry_sample_wheels(int32_t left, int32_t right)
+{
+    agg_add(&left_speed, left);
+    agg_add(&right_speed, right);
+}
+
+void telemetry_sample_bearing(int b)
+{
+    if (bearing.n == 0)
+        bearing_ref = b;
+    agg_add(&bearing, get_bearing_error(bearing_ref, b));
+}
+
+void telemetry_sample_ultrasonic(uint32_t cm)
+{
+    agg_add(&ultrasonic, MIN(cm, INT32_MAX));
+}
+
+static int wrap360(int b)
+{
+    return (b % 360 + 360) % 360;
+}
+
+static void send_tasks(void)
+{
+    static TaskStatus_t status[12];
+    char line[100];
+    UBaseType_t n = uxTaskGetSystemState(status, 12, NULL);
+    snprintf(line, sizeof(line), "[TSK]tasks:%lu\theap:%u\tmin:%u\n",
+             n, xPortGetFreeHeapSize(), xPortGetMinimumEverFreeHeapSize());
+    telemetry_publish(TLM_TASKS, line);
+    for (UBaseType_t i = 0; i < n; ++i)
+    {
+        snprintf(line, sizeof(line), "[TSK]%s\tprio:%lu\tstack:%u\n",
+                 status[i].pcTaskName, status[i].uxCurrentPriority, status[i].usStackHighWaterMark);
+        telemetry_publish(TLM_TASKS, line);
+    }
+}
+
+// Called by sense_task after each reading: sends the aggregated streams that are due
+void telemetry_poll(void)
+{
+    char line[100];
+    if (telemetry_due(TLM_ENCODERS))
+    {
+        tlm_agg l = agg_take(&left_speed), r = agg_take(&right_speed);
+        snprintf(line, sizeof(line), "[ENC]lc:%lld\trc:%lld\tls:%ld/%ld/%ld\trs:%ld/%ld/%ld\tn:%lu\n",
+                 leftwheelcode, rightwheelcode, l.min, agg_mean(&l), l.max, r.min, agg_mean(&r), r.max, l.n);
+        telemetry_publish(TLM_ENCODERS, line);
+    }
+    if (telemetry_due(TLM_BEARING))
+    {
+        int ref = bearing_ref;
+        tlm_agg b = agg_take(&bearing);
+        snprintf(line, sizeof(line), "[BRG]cur:%d\tmin:%d\tmean:%d\tmax:%d\tn:%lu\n",
+                 current_bearing, wrap360(ref + b.min), wrap360(ref + agg_mean(&b)), wrap360(ref + b.max), b.n);
+        telemetry_publish(TLM_BEARING, line);
+    }
+    if (telemetry_due(TLM_ULTRASONIC))
+    {
+        tlm_agg u = agg_take(&ultrasonic);
+        snprintf(line, sizeof(line), "[US]cur:%ld\tmin:%ld\tmean:%ld\tmax:%ld\tn:%lu\n",
+                 u.last, u.min, agg_mean(&u), u.max, u.n);
+        telemetry_publish(TLM_ULTRASONIC, line);
+    }
+    if (telemetry_due(TLM_TASKS))
+        send_tasks();
+}
+
+// rate of every stream, "-" for the ones sent as they happen
+int telemetry_report(char *out, int len)
+{
+    int n = snprintf(out, len, "[TLM]");
+    for (int s = 0; s < TLM_COUNT && n < len; ++s)
+    {
+        if (s == TLM_EVENTS || s == TLM_BARCODE || s == TLM_LOG)
+            n += snprintf(out + n, len - n, "%d.%s:-\t", s, names[s]);
+        else
+            n += snprintf(out + n, len - n, "%d.%s:%lu\t", s, names[s], rate_hz[s]);
+    }
+    if (n < len)
+        out[n - 1] = '\n';
+    return MIN(n, len - 1);
+}
@@ -0,0 +1,47 @@
+#ifndef telemetry_h
+#define telemetry_h
+#include "pico/stdlib.h"
+
+// Telemetry streams for the TCP clients. Each stream has one rate for every
+// client, a client picks the streams it wants with "sub" (bit n is stream n,
+// the same bits as SERVER_STREAM_). "tlm <stream>,<hz>" sets a rate, 0 turns
+// the stream off. Nothing is sampled or formatted for a stream no client wants.
+//
+// Encoder speeds, bearing and ultrasonic are sampled as they are produced and
+// reported as min/mean/max over the window since the last report, PID is the
+// state of the running controller when it is due. Events, barcodes and log
+// lines are sent as they happen, their rate is ignored.
+
+typedef enum tlm_stream_ {
+    TLM_PID,        // [FWD] [TUN] ... lines of the running mode
+    TLM_EVENTS,     // mission progress, bench results
+    TLM_CAL,        // magnetometer calibration
+    TLM_ENCODERS,   // [ENC] counts, wheel speed min/mean/max
+    TLM_BEARING,    // [BRG] bearing min/mean/max
+    TLM_ULTRASONIC, // [US] distance min/mean/max
+    TLM_BARCODE,    // decoded characters
+    TLM_TASKS,      // [TSK] heap and per task stack high water
+    TLM_LOG,        // LOG() lines, see logging.h
+    TLM_COUNT
+} tlm_stream;
+
+#define TLM_MAX_HZ 100
+
+// running min/max/sum between reports
+typedef struct tlm_agg_ {
+    int32_t min, max, sum;
+    uint32_t n;
+    int32_t last;
+} tlm_agg;
+
+bool telemetry_set_rate(tlm_stream stream, uint32_t hz);
+bool telemetry_wanted(tlm_stream stream);
+bool telemetry_due(tlm_stream stream);
+void telemetry_publish(tlm_stream stream, const char *line);
+void telemetry_sample_wheels(int32_t left_speed, int32_t right_speed);
+void telemetry_sample_bearing(int bearing);
+void telemetry_sample_ultrasonic(uint32_t cm);
+void telemetry_poll(void);
+int telemetry_report(char *out, int len);
+
+#endif
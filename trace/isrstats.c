@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <string.h>
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "isrstats.h"
+#include "hotpath.h"
+
+volatile uint32_t isrstats_vector_us;
+static isr_source_stats sources[ISRSTATS_SOURCES];
+static uint32_t report_us;
+
+static inline uint hist_bin(uint32_t us)
+{
+    uint bin = us ? 32 - __builtin_clz(us) : 0;
+    return bin < ISRSTATS_BINS ? bin : ISRSTATS_BINS - 1;
+}
+
+// First of the IO_IRQ_BANK0 shared handlers, ahead of the GPIO dispatch
+static void HOT(vector_stamp)(void)
+{
+    isrstats_vector_us = time_us_32();
+}
+
+void isrstats_init(void)
+{
+    isrstats_reset();
+    irq_add_shared_handler(IO_IRQ_BANK0, vector_stamp, PICO_SHARED_IRQ_HANDLER_HIGHEST_ORDER_PRIORITY);
+}
+
+void isrstats_reset(void)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    memset(sources, 0, sizeof(sources));
+    report_us = time_us_32();
+    restore_interrupts(irq);
+}
+
+// From the GPIO dispatch, the only writer of a pin's stats
+void HOT(isrstats_record)(uint gpio, uint32_t entry_us, uint32_t exit_us)
+{
+    if (gpio >= ISRSTATS_SOURCES)
+        return;
+    isr_source_stats *s = &sources[gpio];
+    uint32_t dur = exit_us - entry_us;
+    uint32_t lat = entry_us - isrstats_vector_us;
+    ++s->count;
+    ++s->dur_hist[hist_bin(dur)];
+    ++s->lat_hist[hist_bin(lat)];
+    if (dur > s->dur_max_us)
+        s->dur_max_us = dur;
+    if (lat > s->lat_max_us)
+        s->lat_max_us = lat;
+}
+
+static int hist_line(char *out, int len, const char *tag, uint gpio, const uint32_t *hist)
+{
+    int n = snprintf(out, len, "[ISR]%u.%s", gpio, tag);
+    for (int i = 0; i < ISRSTATS_BINS && n < len; ++i)
+        n += snprintf(out + n, len - n, ":%lu", hist[i]);
+    if (n < len)
+        n += snprintf(out + n, len - n, "\n");
+    return n;
+}
+
+// Line 0 is the window, then three lines per GPIO that has fired: count and
+// rate since the last report, duration and latency histograms. Returns 0
+// once there are no more lines.
+int isrstats_report(char *out, int len, int line)
+{
+    static uint32_t window_us;
+    if (line == 0)
+    {
+        uint32_t now = time_us_32();
+        window_us = now - report_us;
+        report_us = now;
+        return snprintf(out, len, "[ISR]window_ms:%lu\n", window_us / 1000);
+    }
+    --line;
+    for (uint gpio = 0; gpio < ISRSTATS_SOURCES; ++gpio)
+    {
+        isr_source_stats *s = &sources[gpio];
+        if (s->count == 0)
+            continue;
+        if (line >= 3)
+        {
+            line -= 3;
+            continue;
+        }
+        if (line == 1)
+            return hist_line(out, len, "dur", gpio, s->dur_hist);
+        if (line == 2)
+            return hist_line(out, len, "lat", gpio, s->lat_hist);
+        uint32_t count = s->count;
+        uint32_t rate = window_us ? (uint64_t)(count - s->reported) * 1000000 / window_us : 0;
+        s->reported = count;
+        return snprintf(out, len, "[ISR]gpio:%u\tn:%lu\tHz:%lu\tdmax:%lu\tlmax:%lu\n",
+                        gpio, count, rate, s->dur_max_us, s->lat_max_us);
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#ifndef isrstats_h
+#define isrstats_h
+#include "pico/stdlib.h"
+
+// Per GPIO interrupt counts, rate, handler duration and entry latency, as
+// log2 histograms like looptimer's. Handler time is from the handler's entry
+// to its exit. Entry latency is from the IO_IRQ_BANK0 vector to the handler,
+// which is the time spent behind the dispatch and the pins served before it
+// in the same interrupt. The time from the edge to the vector (interrupts
+// masked, other IRQs running) has no timestamp to measure it against.
+//   uint32_t t = isrstats_enter();
+//   ...handler...
+//   isrstats_exit(gpio, t);
+
+#define ISRSTATS_SOURCES 30 // GPIO 0-29
+#define ISRSTATS_BINS 12    // bin 0 is 0us, bin n is [2^(n-1), 2^n) us, last bin catches the rest
+
+typedef struct isr_source_stats_ {
+    uint32_t count;
+    uint32_t reported;  // count at the last report, for the rate
+    uint32_t dur_max_us;
+    uint32_t lat_max_us;
+    uint32_t dur_hist[ISRSTATS_BINS];
+    uint32_t lat_hist[ISRSTATS_BINS];
+} isr_source_stats;
+
+void isrstats_init(void);
+void isrstats_reset(void);
+int isrstats_report(char *out, int len, int line);
+
+extern volatile uint32_t isrstats_vector_us;
+void isrstats_record(uint gpio, uint32_t entry_us, uint32_t exit_us);
+
+static inline uint32_t isrstats_enter(void)
+{
+    return time_us_32();
+}
+
+static inline void isrstats_exit(uint gpio, uint32_t entry_us)
+{
+    isrstats_record(gpio, entry_us, time_us_32());
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <string.h>
+#include "hardware/sync.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "trace.h"
+#include "hotpath.h"
+
+#define TRACE_MAX_TASKS 16
+
+volatile bool trace_on = true;
+
+// head counts every event ever written, the ring holds the last TRACE_EVENTS
+static trace_record ring[TRACE_EVENTS];
+static volatile uint32_t head = 0;
+
+// in SRAM, it runs inside every traced interrupt
+void HOT(trace_write)(uint8_t type, uint8_t id, uint16_t arg)
+{
+    uint32_t t = time_us_32();
+    uint32_t irq = save_and_disable_interrupts();
+    trace_record *e = &ring[head & (TRACE_EVENTS - 1)];
+    e->t_us = t;
+    e->type = type;
+    e->id = id;
+    e->arg = arg;
+    ++head;
+    restore_interrupts(irq);
+}
+
+// Called by the kernel from traceTASK_SWITCHED_IN/OUT with the scheduler locked,
+// number is the task's TCB number, the key of the dump's name table
+void trace_task_switch(int switched_in, unsigned number)
+{
+    if (trace_on)
+        trace_write(switched_in ? TRACE_TASK_IN : TRACE_TASK_OUT, number, 0);
+}
+
+// dump in progress, tracing stays off until it is done
+static struct {
+    bool busy, resume;
+    uint32_t first, events, sent;
+    uint8_t prefix[48 + sizeof(trace_dump_header) + TRACE_MAX_TASKS * sizeof(trace_task_name)];
+    int prefix_len, prefix_sent;
+} dump;
+
+void trace_start(void)
+{
+    if (!dump.busy)
+        trace_on = true;
+}
+
+void trace_stop(void)
+{
+    trace_on = false;
+}
+
+// Claim the dump, false if another client's dump is still being sent
+bool trace_dump_begin(void)
+{
+    uint32_t irq = save_and_disable_interrupts();
+    bool ok = !dump.busy;
+    if (ok)
+    {
+        dump.busy = true;
+        dump.resume = trace_on;
+        dump.prefix_len = 0;
+        trace_on = false;
+    }
+    restore_interrupts(irq);
+    return ok;
+}
+
+// "[TRC]bytes:N" line, header and task table, built on the first fill in task context
+static void dump_prepare(void)
+{
+    static TaskStatus_t status[TRACE_MAX_TASKS];
+    UBaseType_t tasks = uxTaskGetSystemState(status, TRACE_MAX_TASKS, NULL);
+    trace_dump_header h = {
+        .magic = TRACE_MAGIC,
+        .now_us = time_us_32(),
+        .events = MIN(head, TRACE_EVENTS),
+        .lost = head > TRACE_EVENTS ? head - TRACE_EVENTS : 0,
+        .tasks = tasks,
+    };
+    dump.first = head - h.events;
+    dump.events = h.events;
+    dump.sent = 0;
+    uint32_t bytes = sizeof(h) + tasks * sizeof(trace_task_name) + h.events * sizeof(trace_record);
+    int n = snprintf((char *)dump.prefix, 48, "[TRC]bytes:%lu\n", bytes);
+    memcpy(dump.prefix + n, &h, sizeof(h));
+    n += sizeof(h);
+    for (UBaseType_t i = 0; i < tasks; ++i)
+    {
+        trace_task_name t = {.number = status[i].xTaskNumber};
+        strncpy(t.name, status[i].pcTaskName, TRACE_NAME_LEN);
+        memcpy(dump.prefix + n, &t, sizeof(t));
+        n += sizeof(t);
+    }
+    dump.prefix_len = n;
+    dump.prefix_sent = 0;
+}
+
+static void dump_end(void)
+{
+    dump.busy = false;
+    trace_on = dump.resume;
+}
+
+// Bulk source for server_attach_bulk: copies the next part of the dump to out.
+// Returns 0 once everything is sent, out NULL cancels, tracing resumes either way.
+int trace_dump_fill(__unused void *ctx, uint8_t *out, int len)
+{
+    if (!dump.busy)
+        return 0;
+    if (out == NULL)
+    {
+        dump_end();
+        return 0;
+    }
+    if (dump.prefix_len == 0)
+        dump_prepare();
+    int n = 0;
+    if (dump.prefix_sent < dump.prefix_len)
+    {
+        n = MIN(len, dump.prefix_len - dump.prefix_sent);
+        memcpy(out, dump.prefix + dump.prefix_sent, n);
+        dump.prefix_sent += n;
+        return n;
+    }
+    while (dump.sent < dump.events && len - n >= (int)sizeof(trace_record))
+    {
+        memcpy(out + n, &ring[(dump.first + dump.sent) & (TRACE_EVENTS - 1)], sizeof(trace_record));
+        n += sizeof(trace_record);
+        ++dump.sent;
+    }
+    if (n == 0)
+        dump_end();
+    return n;
+}
+
+int trace_report(char *out, int len)
+{
+    return snprintf(out, len, "[TRC]on:%d\tevents:%lu\tring:%d\tdump:%d\n",
+                    trace_on, head, TRACE_EVENTS, dump.busy);
+}
@@ -0,0 +1,35 @@
+#ifndef trace_h
+#define trace_h
+#include "pico/stdlib.h"
+#include "trace_format.h"
+
+// Flight recorder for timing. trace_event() stores a timestamped 8 byte record
+// in a RAM ring that keeps the last TRACE_EVENTS, overwriting the oldest.
+// Safe from ISRs and the scheduler, a record costs a few dozen cycles with
+// interrupts off, nothing when tracing is stopped.
+//
+// Recorded: GPIO IRQ entry and exit per pin, task switches (FreeRTOSConfig.h
+// hooks), wheel PWM outputs, received and applied commands, messages queued
+// for the TCP clients. "tracedump" stops tracing and sends the ring to the
+// client that asked, trace/trace2json.c turns it into a timeline.
+
+#define TRACE_EVENTS 1024 // power of two
+
+extern volatile bool trace_on;
+
+void trace_write(uint8_t type, uint8_t id, uint16_t arg);
+
+static inline void trace_event(trace_type type, uint8_t id, uint16_t arg)
+{
+    if (trace_on)
+        trace_write(type, id, arg);
+}
+
+void trace_start(void);
+void trace_stop(void);
+void trace_task_switch(int switched_in, unsigned number);
+bool trace_dump_begin(void);
+int trace_dump_fill(void *ctx, uint8_t *out, int len);
+int trace_report(char *out, int len);
+
+#endif
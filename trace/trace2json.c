@@ -0,0 +1,263 @@
+// Host tool, not part of the firmware build. Fetches a trace dump from the car
+// and writes it as Chrome trace JSON, open it in ui.perfetto.dev or chrome://tracing.
+//   cc -O2 -Itrace trace/trace2json.c -o trace2json
+//   ./trace2json <car ip> [port] > trace.json   fetch with "tracedump", port 4242 by default
+//   ./trace2json -r dump.bin <car ip> > trace.json   also keep the raw dump
+//   ./trace2json -f dump.bin > trace.json       convert a saved dump
+// IRQs and tasks become slices, one track per GPIO and per task, the move_task
+// loop is a slice from wake to done, wheel PWM a counter, commands and sends
+// instant events.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include "trace_format.h"
+
+#define PID_IRQ 1
+#define PID_TASKS 2
+#define PID_CONTROL 3
+
+static int fetch(const char *host, const char *port, uint8_t **out)
+{
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM}, *ai;
+    if (getaddrinfo(host, port, &hints, &ai) != 0)
+    {
+        fprintf(stderr, "can't resolve %s\n", host);
+        return -1;
+    }
+    int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0 || connect(fd, ai->ai_addr, ai->ai_addrlen) < 0)
+    {
+        perror("connect");
+        return -1;
+    }
+    freeaddrinfo(ai);
+    // no telemetry in the way, then the dump
+    const char *req = "sub 0\ntracedump\n";
+    if (write(fd, req, strlen(req)) < 0)
+    {
+        perror("write");
+        return -1;
+    }
+    FILE *f = fdopen(fd, "rb");
+    char line[256];
+    int n = 0, c;
+    long bytes = -1;
+    // replies are text lines ending in "\n\0", skip them up to the dump line
+    while (bytes < 0 && (c = fgetc(f)) != EOF)
+    {
+        if (c == '\0')
+            continue;
+        if (c != '\n' && n < (int)sizeof(line) - 1)
+        {
+            line[n++] = c;
+            continue;
+        }
+        line[n] = '\0';
+        n = 0;
+        if (strncmp(line, "[TRC]bytes:", 11) == 0)
+            bytes = atol(line + 11);
+        else if (strcmp(line, "trace busy") == 0)
+        {
+            fprintf(stderr, "another dump is running\n");
+            return -1;
+        }
+        else
+            fprintf(stderr, "%s\n", line);
+    }
+    if (bytes < 0)
+    {
+        fprintf(stderr, "connection closed before the dump\n");
+        return -1;
+    }
+    *out = malloc(bytes);
+    if (fread(*out, 1, bytes, f) != (size_t)bytes)
+    {
+        fprintf(stderr, "dump cut short\n");
+        return -1;
+    }
+    fclose(f);
+    return bytes;
+}
+
+static int load(const char *path, uint8_t **out)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long bytes = ftell(f);
+    rewind(f);
+    *out = malloc(bytes);
+    if (fread(*out, 1, bytes, f) != (size_t)bytes)
+        bytes = -1;
+    fclose(f);
+    return bytes;
+}
+
+static bool first_event = true;
+
+static void event(const char *ph, const char *name, int pid, int tid, double ts, const char *args)
+{
+    printf("%s\n{\"ph\":\"%s\",\"name\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.0f%s%s%s}",
+           first_event ? "" : ",", ph, name, pid, tid, ts, args ? ",\"args\":{" : "", args ? args : "", args ? "}" : "");
+    first_event = false;
+}
+
+static void meta(const char *what, int pid, int tid, const char *name)
+{
+    char args[64];
+    snprintf(args, sizeof(args), "\"name\":\"%s\"", name);
+    event("M", what, pid, tid, 0, args);
+}
+
+static int convert(const uint8_t *dump, int bytes)
+{
+    trace_dump_header h;
+    if (bytes < (int)sizeof(h))
+        return -1;
+    memcpy(&h, dump, sizeof(h));
+    if (h.magic != TRACE_MAGIC || bytes != (int)(sizeof(h) + h.tasks * sizeof(trace_task_name) + h.events * sizeof(trace_record)))
+    {
+        fprintf(stderr, "not a trace dump\n");
+        return -1;
+    }
+    const uint8_t *p = dump + sizeof(h);
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    meta("process_name", PID_IRQ, 0, "GPIO IRQ");
+    meta("process_name", PID_TASKS, 0, "tasks");
+    meta("process_name", PID_CONTROL, 0, "control");
+    meta("thread_name", PID_CONTROL, 0, "move_task loop");
+    meta("thread_name", PID_CONTROL, 1, "commands");
+    meta("thread_name", PID_CONTROL, 2, "sends");
+    for (int i = 0; i < h.tasks; ++i, p += sizeof(trace_task_name))
+    {
+        trace_task_name t;
+        memcpy(&t, p, sizeof(t));
+        char name[TRACE_NAME_LEN + 1] = "";
+        memcpy(name, t.name, TRACE_NAME_LEN);
+        meta("thread_name", PID_TASKS, t.number, name);
+    }
+    // a slice only ends if the dump saw it start, the oldest events may be halfway through one
+    bool irq_open[32] = {0}, task_open[256] = {0}, loop_open = false;
+    uint32_t prev = 0;
+    double ts = 0;
+    for (uint32_t i = 0; i < h.events; ++i, p += sizeof(trace_record))
+    {
+        trace_record e;
+        memcpy(&e, p, sizeof(e));
+        ts += i ? (uint32_t)(e.t_us - prev) : 0; // unwrap the 32 bit microseconds
+        prev = e.t_us;
+        char name[48], args[64] = "";
+        switch (e.type)
+        {
+        case TRACE_IRQ_ENTER:
+            snprintf(name, sizeof(name), "gpio %d", e.id);
+            snprintf(args, sizeof(args), "\"events\":%u", e.arg);
+            event("B", name, PID_IRQ, e.id, ts, args);
+            irq_open[e.id & 31] = true;
+            break;
+        case TRACE_IRQ_EXIT:
+            if (irq_open[e.id & 31])
+                event("E", "", PID_IRQ, e.id, ts, NULL);
+            irq_open[e.id & 31] = false;
+            break;
+        case TRACE_TASK_IN:
+            event("B", "running", PID_TASKS, e.id, ts, NULL);
+            task_open[e.id] = true;
+            break;
+        case TRACE_TASK_OUT:
+            if (task_open[e.id])
+                event("E", "", PID_TASKS, e.id, ts, NULL);
+            task_open[e.id] = false;
+            break;
+        case TRACE_LOOP_WAKE:
+            snprintf(args, sizeof(args), "\"outer_tick\":%u", e.arg);
+            event("B", "tick", PID_CONTROL, 0, ts, args);
+            loop_open = true;
+            break;
+        case TRACE_LOOP_DONE:
+            if (e.id)
+                snprintf(args, sizeof(args), "\"mode\":%u", e.arg);
+            if (loop_open)
+                event("E", "", PID_CONTROL, 0, ts, e.id ? args : NULL);
+            else
+                event("i", "pass", PID_CONTROL, 0, ts, args);
+            loop_open = false;
+            break;
+        case TRACE_CONTROL:
+            snprintf(args, sizeof(args), "\"%s\":%u", e.id ? "right" : "left", e.arg);
+            event("C", "pwm", PID_CONTROL, 0, ts, args);
+            break;
+        case TRACE_COMMAND:
+            snprintf(name, sizeof(name), "op %d", e.id);
+            snprintf(args, sizeof(args), "\"arg\":%d", (int16_t)e.arg);
+            event("i", name, PID_CONTROL, 1, ts, args);
+            break;
+        case TRACE_APPLIED:
+            snprintf(name, sizeof(name), "applied %d", e.id);
+            snprintf(args, sizeof(args), "\"seq\":%u", e.arg);
+            event("i", name, PID_CONTROL, 1, ts, args);
+            break;
+        case TRACE_SEND:
+            if (e.id == TRACE_SEND_REPLY)
+                snprintf(name, sizeof(name), "reply");
+            else
+                snprintf(name, sizeof(name), "stream %d", e.id);
+            snprintf(args, sizeof(args), "\"bytes\":%u", e.arg);
+            event("i", name, PID_CONTROL, 2, ts, args);
+            break;
+        default:
+            snprintf(name, sizeof(name), "mark %d", e.id);
+            snprintf(args, sizeof(args), "\"arg\":%u", e.arg);
+            event("i", name, PID_CONTROL, 0, ts, args);
+            break;
+        }
+    }
+    printf("\n]}\n");
+    fprintf(stderr, "%lu events over %.3f ms, %lu lost before the dump, %u tasks\n",
+            (unsigned long)h.events, ts / 1000, (unsigned long)h.lost, h.tasks);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *file = NULL, *raw = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:r:")) != -1)
+    {
+        if (opt == 'f')
+            file = optarg;
+        else if (opt == 'r')
+            raw = optarg;
+        else
+            return 2;
+    }
+    if (file == NULL && optind >= argc)
+    {
+        fprintf(stderr, "usage: %s [-r raw.bin] <host> [port] | -f raw.bin\n", argv[0]);
+        return 2;
+    }
+    uint8_t *dump = NULL;
+    int bytes = file ? load(file, &dump) : fetch(argv[optind], optind + 1 < argc ? argv[optind + 1] : "4242", &dump);
+    if (bytes < 0)
+        return 1;
+    if (raw)
+    {
+        FILE *f = fopen(raw, "wb");
+        if (f == NULL || fwrite(dump, 1, bytes, f) != (size_t)bytes)
+            perror(raw);
+        if (f)
+            fclose(f);
+    }
+    int err = convert(dump, bytes);
+    free(dump);
+    return err ? 1 : 0;
+}
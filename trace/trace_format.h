@@ -0,0 +1,50 @@
+#ifndef trace_format_h
+#define trace_format_h
+#include <stdint.h>
+
+// Trace dump layout, shared by the firmware and trace2json. Little endian:
+//   trace_dump_header
+//   tasks * trace_task_name
+//   events * trace_record, oldest first
+
+#define TRACE_MAGIC 0x31435254 // "TRC1"
+#define TRACE_NAME_LEN 12
+#define TRACE_SEND_REPLY 0xff
+
+typedef enum trace_type_ {
+    TRACE_IRQ_ENTER,  // id gpio, arg the edge events
+    TRACE_IRQ_EXIT,   // id gpio
+    TRACE_TASK_IN,    // id task number
+    TRACE_TASK_OUT,   // id task number
+    TRACE_LOOP_WAKE,  // move_task woke for a loop tick, arg outer tick count
+    TRACE_LOOP_DONE,  // move_task done, id 0 inner only, 1 outer pass with arg the mode
+    TRACE_CONTROL,    // id wheel, 0 left 1 right, arg pwm
+    TRACE_COMMAND,    // id proto op as received, arg first argument
+    TRACE_APPLIED,    // id move command op, arg seq, once move_task acted on it
+    TRACE_SEND,       // id stream number, TRACE_SEND_REPLY for a reply, arg bytes
+    TRACE_MARK,       // free for ad hoc use
+    TRACE_TYPE_COUNT
+} trace_type;
+
+typedef struct __attribute__((packed)) trace_record_ {
+    uint32_t t_us;
+    uint8_t type;
+    uint8_t id;
+    uint16_t arg;
+} trace_record;
+
+typedef struct __attribute__((packed)) trace_dump_header_ {
+    uint32_t magic;
+    uint32_t now_us;   // when the dump started, the last event is before this
+    uint32_t events;
+    uint32_t lost;     // events overwritten before the dump
+    uint16_t tasks;
+    uint16_t reserved;
+} trace_dump_header;
+
+typedef struct __attribute__((packed)) trace_task_name_ {
+    uint8_t number;
+    char name[TRACE_NAME_LEN];
+} trace_task_name;
+
+#endif
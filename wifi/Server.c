@@ -1,46 +1,294 @@
 #include "Server.h"
+#include "logging.h"
+#include "trace.h"
 
 TCP_SERVER_T *myServer = NULL;
-MessageBufferHandle_t wifiMsgBuffer;
-MessageBufferHandle_t wifiMsgBufferFromISR;
+
+static TaskHandle_t tx_task = NULL;
+
+static void tx_wake(void) {
+    if (tx_task == NULL)
+        return;
+    if (portCHECK_IF_IN_ISR()) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(tx_task, &woken);
+        portYIELD_FROM_ISR(woken);
+    } else {
+        xTaskNotifyGive(tx_task);
+    }
+}
+
+// Drop everything queued, the connection that would have acked it is gone
+static void tx_discard(server_client *client) {
+    UBaseType_t irq = taskENTER_CRITICAL_FROM_ISR();
+    client->queued = client->acked = client->head;
+    taskEXIT_CRITICAL_FROM_ISR(irq);
+}
 
 static TCP_SERVER_T* tcp_server_init(void) {  // Initialize the TCP server state.
     TCP_SERVER_T *state = calloc(1, sizeof(TCP_SERVER_T));  // Allocate memory for the server state.
     if (!state) {  // Check if memory allocation failed.
         return NULL;
     }
+    for (int i = 0; i < SERVER_MAX_CLIENTS; ++i)
+        state->clients[i].id = i;
     return state;
 }
 
+static void client_cancel_bulk(server_client *client) {
+    server_bulk_fill fill = client->bulk;
+    client->bulk = NULL;
+    if (fill)
+        fill(client->bulk_ctx, NULL, 0);
+}
+
+// Free the slot, the pcb is gone or no longer references the ring
+static void client_release(server_client *client) {
+    client->connected = false;
+    client->closing = false;
+    client->pcb = NULL;
+    tx_discard(client);
+    client_cancel_bulk(client);
+}
+
 static void tcp_server_err(void *arg, err_t err) {  // Handle TCP server errors.
     if (err != ERR_ABRT) {  // Check if the error is not an abort error.
-        printf("Error code: %d\n", err);  // Print the error code.
+        LOG("Error code: %d\n", err);  // Print the error code.
     }
+    // lwIP has already freed the pcb
+    client_release((server_client*)arg);
 }
 
-err_t tcp_server_send_data(struct pbuf *p, TCP_SERVER_T *state) {  // Send data over the TCP connection.
-    if (state == NULL) {
+static void client_detach(server_client *client) {
+    struct tcp_pcb *pcb = client->pcb;
+    tcp_arg(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    tcp_err(pcb, NULL);
+    client_release(client);
+}
+
+// Close a client from lwIP context, e.g. once it has closed its end.
+// tcp_write referenced the ring without copying, so a slot with sent but
+// unacked bytes stays reserved until tcp_server_sent sees them acked, or
+// tcp_server_err reports the pcb gone. Returns ERR_ABRT if the pcb had to be
+// aborted, a recv callback must pass that on to lwIP.
+err_t server_close(server_client *client) {
+    struct tcp_pcb *pcb = client->pcb;
+    if (pcb == NULL) {
+        client_release(client);
         return ERR_OK;
     }
-    if (state->connected == false){
-        return ERR_OK;
+    client->connected = false;  // nothing new is queued or pumped
+    client->head = client->queued;  // never handed to lwIP
+    client_cancel_bulk(client);
+    tcp_recv(pcb, NULL);
+    LOG("Client %d closed\n", client->id);
+    if (tcp_close(pcb) != ERR_OK) {
+        tcp_abort(pcb);  // frees the segments, tcp_server_err releases the slot
+        return ERR_ABRT;
     }
-    int len = p->tot_len;
-    if (p->tot_len > BUF_SIZE) len = BUF_SIZE;
-    strncpy(state->buffer_sent, p->payload, len);  // Copy "ok" to the send buffer.
-    
-    cyw43_arch_lwip_begin(); // Aquire lock for wifi
-    cyw43_arch_lwip_check(); // Check the lwIP stack for readiness.
-    err_t err = tcp_write(state->client_pcb, state->buffer_sent, len, TCP_WRITE_FLAG_COPY);  // Write data to the TCP connection.
-    cyw43_arch_lwip_end(); //release the locks
-    
-    if (err != ERR_OK) {  // Check if the write operation failed.
-        printf("Failed to write data!\n");  // Print an error message.
-        return err;
+    if (client->acked == client->queued)
+        client_detach(client);
+    else
+        client->closing = true;
+    return ERR_OK;
+}
+
+// lwIP callback once the client has acked len bytes, that part of the ring can be reused
+static err_t tcp_server_sent(void *arg, struct tcp_pcb *tpcb, u16_t len) {
+    server_client *client = (server_client*)arg;
+    client->acked += len;
+    client->stats.bytes_acked += len;
+    if (client->closing) {
+        if (client->acked == client->queued)
+            client_detach(client);
+        return ERR_OK;
     }
+    tx_wake(); // more send buffer is free as well
     return ERR_OK;
 }
 
+// Copy one message into a client's ring. A message that doesn't fit is
+// dropped whole, one slow client never holds the others back. Messages for a
+// client in a bulk transfer are dropped too, they would land inside it.
+static bool client_queue(server_client *client, const void *data, size_t len, bool bulk) {
+    bool isr = portCHECK_IF_IN_ISR();
+    UBaseType_t irq = 0;
+    if (isr)
+        irq = taskENTER_CRITICAL_FROM_ISR();
+    else
+        taskENTER_CRITICAL();
+    uint32_t used = client->head - client->acked;
+    bool fits = client->connected && (client->bulk == NULL || bulk) && len <= SERVER_TX_RING - used;
+    if (fits) {
+        uint32_t off = client->head & (SERVER_TX_RING - 1);
+        uint32_t first = MIN(len, SERVER_TX_RING - off);
+        memcpy(client->ring + off, data, first);
+        memcpy(client->ring, (const uint8_t *)data + first, len - first);
+        client->head += len;
+        ++client->stats.msgs;
+        if (used + len > client->stats.high_water)
+            client->stats.high_water = used + len;
+    } else if (client->connected) {
+        ++client->stats.dropped;
+    }
+    if (isr)
+        taskEXIT_CRITICAL_FROM_ISR(irq);
+    else
+        taskEXIT_CRITICAL();
+    return fits;
+}
+
+// Fan a message out to every client subscribed to stream, from any task or
+// ISR. The caller formats once, each client gets a copy of the same bytes.
+// Never blocks. Returns the number of clients it was queued for.
+int server_publish(uint32_t stream, const void *data, size_t len) {
+    if (myServer == NULL)
+        return 0;
+    int sent = 0;
+    for (int i = 0; i < SERVER_MAX_CLIENTS; ++i) {
+        server_client *client = &myServer->clients[i];
+        if (client->connected && (client->subscriptions & stream))
+            sent += client_queue(client, data, len, false);
+    }
+    if (sent) {
+        trace_event(TRACE_SEND, __builtin_ctz(stream), MIN(len, UINT16_MAX));
+        tx_wake();
+    }
+    return sent;
+}
+
+// Answer one client only, regardless of its subscriptions. Returns the bytes queued.
+size_t server_reply(server_client *client, const void *data, size_t len) {
+    if (client == NULL || !client_queue(client, data, len, false))
+        return 0;
+    trace_event(TRACE_SEND, TRACE_SEND_REPLY, MIN(len, UINT16_MAX));
+    tx_wake();
+    return len;
+}
+
+void server_subscribe(server_client *client, uint32_t streams) {
+    client->subscriptions = streams;
+}
+
+// Send a large block to one client, e.g. a trace dump, pulled from fill in
+// ServerTxTask as the ring drains rather than copied up front. Everything
+// else for the client is dropped until fill returns 0. False if one is
+// already running.
+bool server_attach_bulk(server_client *client, server_bulk_fill fill, void *ctx) {
+    if (client == NULL || !client->connected || client->bulk != NULL)
+        return false;
+    client->bulk_ctx = ctx;
+    client->bulk = fill;
+    tx_wake();
+    return true;
+}
+
+// Streams at least one connected client wants, so nobody formats a line that goes nowhere
+uint32_t server_subscribed(void) {
+    uint32_t streams = 0;
+    if (myServer == NULL)
+        return 0;
+    for (int i = 0; i < SERVER_MAX_CLIENTS; ++i)
+        if (myServer->clients[i].connected)
+            streams |= myServer->clients[i].subscriptions;
+    return streams;
+}
+
+// Top the ring up from the bulk source, in chunks that fit whole
+static void client_fill(server_client *client) {
+    static uint8_t chunk[512];  // only ServerTxTask fills
+    server_bulk_fill fill = client->bulk;
+    while (fill != NULL && SERVER_TX_RING - (client->head - client->acked) >= sizeof(chunk)) {
+        int n = fill(client->bulk_ctx, chunk, sizeof(chunk));
+        if (n <= 0) {
+            client->bulk = NULL;
+            break;
+        }
+        client_queue(client, chunk, n, true);
+    }
+}
+
+// Hand everything queued to lwIP in as few writes as the ring wrap and send
+// buffer allow, lwIP packs them into MSS sized segments.
+static void client_pump(server_client *client) {
+    struct tcp_pcb *pcb = client->pcb;
+    if (client->closing)
+        return; // lwIP still sends from [acked, queued)
+    if (!client->connected || pcb == NULL) {
+        tx_discard(client);
+        return;
+    }
+    client_fill(client);
+    bool wrote = false;
+    while (true) {
+        uint32_t pending = client->head - client->queued;
+        uint32_t off = client->queued & (SERVER_TX_RING - 1);
+        uint32_t n = MIN(pending, SERVER_TX_RING - off);
+        n = MIN(n, tcp_sndbuf(pcb));
+        if (n == 0)
+            break; // nothing left, or wait for tcp_server_sent to free send buffer
+        err_t err = tcp_write(pcb, client->ring + off, n, pending > n ? TCP_WRITE_FLAG_MORE : 0);
+        if (err != ERR_OK) {
+            if (err != ERR_MEM) // ERR_MEM is the segment queue being full, retried on the next ack
+                ++client->stats.write_errors;
+            break;
+        }
+        client->queued += n;
+        wrote = true;
+    }
+    if (wrote)
+        tcp_output(pcb);
+}
+
+static void server_tx_pump(void) {
+    if (myServer == NULL)
+        return;
+    cyw43_arch_lwip_begin();
+    for (int i = 0; i < SERVER_MAX_CLIENTS; ++i)
+        client_pump(&myServer->clients[i]);
+    cyw43_arch_lwip_end();
+}
+
+void server_tx_task(__unused void *params) {
+    tx_task = xTaskGetCurrentTaskHandle();
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        server_tx_pump();
+    }
+}
+
+static int server_client_count(void) {
+    int n = 0;
+    for (int i = 0; i < SERVER_MAX_CLIENTS; ++i)
+        n += myServer->clients[i].connected;
+    return n;
+}
+
+// One line per connected client: throughput since its last report, ring
+// depth and counters. Returns 0 past the last client.
+int server_tx_report(char *out, int len, int line) {
+    if (myServer == NULL)
+        return 0;
+    if (line == 0)
+        return snprintf(out, len, "[NET]clients:%d/%d\trefused:%lu\n",
+                        server_client_count(), SERVER_MAX_CLIENTS, myServer->refused);
+    for (int i = 0; i < SERVER_MAX_CLIENTS; ++i) {
+        server_client *client = &myServer->clients[i];
+        if (!client->connected || --line > 0)
+            continue;
+        uint32_t now = time_us_32();
+        uint32_t acked = client->stats.bytes_acked;
+        uint32_t rate = now != client->report_us ? (uint64_t)(acked - client->report_acked) * 1000000 / (now - client->report_us) : 0;
+        client->report_acked = acked;
+        client->report_us = now;
+        return snprintf(out, len, "[NET]id:%d\tsub:%lx\tB/s:%lu\tdepth:%lu\tunsent:%lu\thw:%lu\tmsgs:%lu\tdrop:%lu\terr:%lu\n",
+                        client->id, client->subscriptions, rate, client->head - client->acked, client->head - client->queued,
+                        client->stats.high_water, client->stats.msgs, client->stats.dropped, client->stats.write_errors);
+    }
+    return 0;
+}
+
 // err_t tcp_server_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {  // Receive data from the TCP connection.
 //     // TCP_SERVER_T *state = (TCP_SERVER_T*)arg;  // Retrieve the server state from the argument.
 //     if (!p) {  // Check if the received packet buffer is invalid.
@@ -63,15 +311,32 @@ err_t tcp_server_send_data(struct pbuf *p, TCP_SERVER_T *state) {  // Send data
 static err_t tcp_server_accept(void *arg, struct tcp_pcb *client_pcb, err_t err) {  // Handle incoming client connections.
     TCP_SERVER_T *state = (TCP_SERVER_T*)arg;  // Retrieve the server state from the argument.
     if (err != ERR_OK || client_pcb == NULL) {  // Check for errors or invalid client protocol control block.
-        printf("Failure in accept\n");  // Print an error message.
+        LOG("Failure in accept\n");  // Print an error message.
         return ERR_VAL;
     }
-    printf("Client connected\n");  // Print a message indicating a successful client connection.
-    state->client_pcb = client_pcb;  // Store the client's protocol control block.
-    tcp_arg(client_pcb, state);  // Set the argument for the client's TCP connection.
+    server_client *client = NULL;
+    for (int i = 0; i < SERVER_MAX_CLIENTS && client == NULL; ++i)
+        if (!state->clients[i].connected && !state->clients[i].closing)
+            client = &state->clients[i];
+    if (client == NULL) {
+        ++state->refused;
+        tcp_abort(client_pcb);
+        return ERR_ABRT;  // Required after tcp_abort in the accept callback.
+    }
+    LOG("Client %d connected\n", client->id);  // Print a message indicating a successful client connection.
+    tx_discard(client);
+    memset(&client->stats, 0, sizeof(client->stats));
+    client->report_acked = 0;
+    client->report_us = time_us_32();
+    client->subscriptions = SERVER_STREAM_ALL;  // Everything until the client narrows it with "sub".
+    client->pcb = client_pcb;  // Store the client's protocol control block.
+    tcp_arg(client_pcb, client);  // Set the argument for the client's TCP connection.
     tcp_recv(client_pcb, tcp_server_recv);  // Set the callback for receiving data on the client connection.
     tcp_err(client_pcb, tcp_server_err);  // Set the callback for handling errors on the client connection.
-    state->connected = true;
+    tcp_sent(client_pcb, tcp_server_sent);  // Release ring space as the client acks.
+    tcp_nagle_disable(client_pcb);  // The pump already batches, don't hold small replies back.
+    tcp_server_opened(client);
+    client->connected = true;
     return ERR_OK;
 }
 
@@ -88,7 +353,7 @@ static bool tcp_server_open(void *arg) {  // Open and start the TCP server.
         printf("Failed to bind to port %u\n", TCP_PORT);  // Print an error message.
         return false;
     }
-    state->server_pcb = tcp_listen_with_backlog(pcb, 1);  // Listen for incoming connections with a backlog of 1.
+    state->server_pcb = tcp_listen_with_backlog(pcb, SERVER_MAX_CLIENTS);  // Listen for incoming connections.
     if (!state->server_pcb) {  // Check if listening failed.
         printf("Failed to listen\n");  // Print an error message.
         if (pcb) {
@@ -96,7 +361,6 @@ static bool tcp_server_open(void *arg) {  // Open and start the TCP server.
         }
         return false;
     }
-    state->connected = false;
     tcp_arg(state->server_pcb, state);  // Set the argument for the server PCB.
     tcp_accept(state->server_pcb, tcp_server_accept);  // Set the callback for accepting client connections.
     myServer = state;
@@ -14,37 +14,81 @@
 
 #include "FreeRTOS.h"  // Include the FreeRTOS library for real-time operating system functionality.
 #include "task.h"  // Include the FreeRTOS library for task management.
-#include "message_buffer.h"
 
 #define TCP_PORT 4242  // Define a constant for the TCP port number the server will use.
-#define BUF_SIZE 2048  // Define a constant for the size of the data buffer.
+#define SERVER_MAX_CLIENTS 4  // Concurrent connections, keep MEMP_NUM_TCP_PCB in lwipopts.h above this.
+// Outgoing bytes wait in the client's ring until it acks them, tcp_write
+// references the ring instead of copying. Power of two.
+#define SERVER_TX_RING 4096
+
+// Streams a client can subscribe to, see server_publish. Bit n is telemetry.h stream n.
+#define SERVER_STREAM_PID        (1u << 0)  // lines from the running controller
+#define SERVER_STREAM_EVENTS     (1u << 1)  // mission progress, bench results
+#define SERVER_STREAM_CAL        (1u << 2)  // magnetometer calibration
+#define SERVER_STREAM_ENCODERS   (1u << 3)
+#define SERVER_STREAM_BEARING    (1u << 4)
+#define SERVER_STREAM_ULTRASONIC (1u << 5)
+#define SERVER_STREAM_BARCODE    (1u << 6)
+#define SERVER_STREAM_TASKS      (1u << 7)
+#define SERVER_STREAM_LOG        (1u << 8)  // LOG() lines as LogTask formats them
+#define SERVER_STREAM_ALL        0xffffffffu
 
 #ifndef RUN_FREERTOS_ON_CORE
 #define RUN_FREERTOS_ON_CORE 0
 #endif
 
+typedef struct server_tx_stats_ {
+    uint32_t bytes_acked;
+    uint32_t msgs;
+    uint32_t dropped;      // messages that did not fit in the ring
+    uint32_t write_errors;
+    uint32_t high_water;   // most bytes held in the ring
+} server_tx_stats;
+
+// Produces the next part of a bulk transfer into out, returns the bytes
+// written, 0 when done. Called with out NULL if the client goes away first.
+typedef int (*server_bulk_fill)(void *ctx, uint8_t *out, int len);
+
+// One connection. The ring uses free running indices masked on access:
+// [acked, queued) is referenced by lwIP until acked, [queued, head) waits for tcp_write
+typedef struct server_client_ {
+    struct tcp_pcb *pcb;
+    volatile bool connected;
+    bool closing;  // closed by us, the slot is kept until lwIP no longer needs the ring
+    uint8_t id;  // slot index
+    volatile uint32_t subscriptions;  // SERVER_STREAM_ bits
+    volatile uint32_t head;
+    volatile uint32_t queued;
+    volatile uint32_t acked;
+    server_tx_stats stats;
+    uint32_t report_acked, report_us;
+    volatile server_bulk_fill bulk;  // while set, only the bulk source writes to the ring
+    void *bulk_ctx;
+    uint8_t ring[SERVER_TX_RING];
+} server_client;
+
 typedef struct TCP_SERVER_T_ {  // Define a custom data structure for the TCP server.
     struct tcp_pcb *server_pcb;  // Pointer to the server's TCP protocol control block.
-    struct tcp_pcb *client_pcb;  // Pointer to the client's TCP protocol control block.
-    bool connected;  // Flag to indicate completion.
-    char buffer_sent[BUF_SIZE];  // Buffer for sent data.
-    uint8_t buffer_recv[BUF_SIZE];  // Buffer for received data.
-    int sent_len;  // Length of sent data.
-    int recv_len;  // Length of received data.
+    server_client clients[SERVER_MAX_CLIENTS];
+    uint32_t refused;  // connections turned away with every slot taken
 } TCP_SERVER_T;
 
 static TCP_SERVER_T* tcp_server_init(void);
 static void tcp_server_err(void *arg, err_t err);
-err_t tcp_server_send_data(struct pbuf *p, TCP_SERVER_T *state);
+int server_publish(uint32_t stream, const void *data, size_t len);
+size_t server_reply(server_client *client, const void *data, size_t len);
+void server_subscribe(server_client *client, uint32_t streams);
+uint32_t server_subscribed(void);
+err_t server_close(server_client *client);
+bool server_attach_bulk(server_client *client, server_bulk_fill fill, void *ctx);
 extern err_t tcp_server_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+extern void tcp_server_opened(server_client *client);
 static err_t tcp_server_accept(void *arg, struct tcp_pcb *client_pcb, err_t err);
 static bool tcp_server_open(void *arg);
 void start_server(__unused void *params);
-void ServerForwardTask();
-void ServerForwardTaskFromISR();
+void server_tx_task(__unused void *params);
+int server_tx_report(char *out, int len, int line);
 void initWifi();
 
 extern TCP_SERVER_T *myServer;
-extern MessageBufferHandle_t wifiMsgBuffer;
-extern MessageBufferHandle_t wifiMsgBufferFromISR;
 #endif
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <string.h>
+#include "pico/cyw43_arch.h"
+#include "lwip/udp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stream.h"
+
+typedef struct stream_slot_ {
+    uint32_t seq;
+    stream_sample sample;
+} stream_slot;
+
+static struct udp_pcb *stream_pcb = NULL;
+static TaskHandle_t task = NULL;
+
+// set from the command channel (lwIP callback, IRQ context), read by move_task and StreamTask
+static ip_addr_t host;
+static volatile uint16_t port = 0; // 0 while off
+static volatile uint32_t period_us = 0;
+static volatile uint32_t batch = 1;
+static volatile stream_encoding encoding = STREAM_RAW;
+static volatile bool restart = false; // next datagram starts with a keyframe
+static stream_codec codec;
+
+// single producer (move_task), single consumer (StreamTask), free running indices
+static stream_slot ring[STREAM_RING];
+static volatile uint32_t head = 0, tail = 0;
+static uint32_t next_seq = 0;
+static uint32_t next_us = 0;
+static stream_stats stats;
+
+static void wake(void)
+{
+    if (task != NULL)
+        xTaskNotifyGive(task);
+}
+
+// Start streaming to host:port, replaces any earlier destination
+bool stream_set(const ip_addr_t *to, uint16_t to_port, uint32_t hz, uint32_t samples, stream_encoding enc)
+{
+    if (to_port == 0 || hz == 0 || hz > STREAM_MAX_HZ || samples == 0 || samples > STREAM_MAX_BATCH || enc > STREAM_DELTA)
+        return false;
+    UBaseType_t irq = taskENTER_CRITICAL_FROM_ISR();
+    ip_addr_copy(host, *to);
+    port = to_port;
+    period_us = 1000000 / hz;
+    batch = samples;
+    encoding = enc;
+    restart = true;
+    next_us = time_us_32();
+    taskEXIT_CRITICAL_FROM_ISR(irq);
+    return true;
+}
+
+void stream_stop(void)
+{
+    port = 0;
+}
+
+// Called by move_task every loop tick, true when the next sample should be taken.
+// A tick a little early still counts, so a rate equal to the loop rate takes every tick.
+bool stream_due(void)
+{
+    if (port == 0)
+        return false;
+    uint32_t now = time_us_32();
+    uint32_t period = period_us;
+    if ((int32_t)(now - next_us + period / 4) < 0)
+        return false;
+    next_us += period;
+    if ((int32_t)(now - next_us) >= 0) // fell behind, e.g. the loop was idle
+        next_us = now + period;
+    return true;
+}
+
+// Queue one sample, never blocks. With the ring full the sample is dropped
+// but its seq is still used, so the receiver sees the gap.
+void stream_push(const stream_sample *sample)
+{
+    uint32_t seq = next_seq++;
+    ++stats.samples;
+    uint32_t used = head - tail;
+    if (used >= STREAM_RING)
+    {
+        ++stats.overruns;
+        return;
+    }
+    stream_slot *slot = &ring[head & (STREAM_RING - 1)];
+    slot->seq = seq;
+    slot->sample = *sample;
+    ++head;
+    if (used + 1 >= batch)
+        wake();
+}
+
+// One datagram of up to count consecutive samples from the tail
+static void send_batch(uint32_t count)
+{
+    static uint8_t frame[sizeof(stream_header) + STREAM_MAX_BATCH * STREAM_MAX_ENCODED];
+    static uint32_t last_seq;
+    uint32_t start_us = time_us_32();
+    stream_header *hdr = (stream_header *)frame;
+    uint8_t *out = frame + sizeof(stream_header);
+    uint32_t first = ring[tail & (STREAM_RING - 1)].seq;
+    bool delta = encoding == STREAM_DELTA;
+    // the receiver's prediction is lost with any sample it never gets
+    if (restart || first != last_seq + 1)
+        stream_codec_reset(&codec);
+    restart = false;
+    uint32_t n = 0;
+    // stop at a gap left by an overrun, the header only carries the first seq
+    while (n < count && ring[(tail + n) & (STREAM_RING - 1)].seq == first + n)
+    {
+        const stream_sample *s = &ring[(tail + n) & (STREAM_RING - 1)].sample;
+        if (delta)
+        {
+            out += stream_encode(&codec, s, out);
+        }
+        else
+        {
+            memcpy(out, s, sizeof(*s));
+            out += sizeof(*s);
+        }
+        ++n;
+    }
+    tail += n;
+    last_seq = first + n - 1;
+    *hdr = (stream_header){.magic = STREAM_MAGIC, .version = delta ? STREAM_VERSION_DELTA : STREAM_VERSION, .count = n, .seq = first};
+    uint16_t len = out - frame;
+    stats.bytes += len - sizeof(stream_header);
+    stats.encode_us += time_us_32() - start_us;
+
+    cyw43_arch_lwip_begin();
+    err_t err = ERR_MEM;
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    if (p != NULL)
+    {
+        memcpy(p->payload, frame, len);
+        err = port ? udp_sendto(stream_pcb, p, &host, port) : ERR_OK;
+        pbuf_free(p);
+    }
+    cyw43_arch_lwip_end();
+    if (err == ERR_OK)
+    {
+        ++stats.frames;
+    }
+    else
+    {
+        ++stats.send_errors;
+        stream_codec_reset(&codec);
+    }
+}
+
+void stream_task(__unused void *params)
+{
+    task = xTaskGetCurrentTaskHandle();
+    stream_codec_init(&codec, STREAM_KEY_INTERVAL);
+    cyw43_arch_lwip_begin();
+    stream_pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+    cyw43_arch_lwip_end();
+    if (stream_pcb == NULL)
+    {
+        printf("Failed to create stream pcb\n");
+        vTaskDelete(NULL);
+    }
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t n = batch;
+        while (head - tail >= n && port != 0)
+            send_batch(MIN(n, STREAM_MAX_BATCH));
+    }
+}
+
+// bytes and ns of encoding per sample sent, to compare raw with delta
+int stream_report(char *out, int len)
+{
+    uint32_t sent = stats.samples - stats.overruns;
+    return snprintf(out, len, "[UDP]port:%u\thz:%lu\tbatch:%lu\t%s\tsmp:%lu\tfrm:%lu\tover:%lu\terr:%lu\tB/smp:%lu\tns/smp:%lu\n",
+                    port, period_us ? 1000000 / period_us : 0, batch, encoding == STREAM_DELTA ? "delta" : "raw",
+                    stats.samples, stats.frames, stats.overruns, stats.send_errors,
+                    sent ? stats.bytes / sent : 0, sent ? (uint32_t)((uint64_t)stats.encode_us * 1000 / sent) : 0);
+}
@@ -0,0 +1,38 @@
+#ifndef stream_h
+#define stream_h
+#include "pico/stdlib.h"
+#include "lwip/ip_addr.h"
+#include "stream_frame.h"
+#include "stream_codec.h"
+
+// Opt-in UDP telemetry. move_task captures a sample at the configured rate,
+// StreamTask sends them to the host that asked for them ("stream port,hz[,batch[,delta]]"
+// on the command channel). Nothing is retransmitted, the receiver counts
+// gaps in seq instead, see stream_recv.c.
+
+#define STREAM_RING 64      // samples, power of two
+#define STREAM_MAX_HZ 1000
+#define STREAM_KEY_INTERVAL 50 // delta encoding sends a keyframe at least this often
+
+typedef enum stream_encoding_ {
+    STREAM_RAW,
+    STREAM_DELTA,
+} stream_encoding;
+
+typedef struct stream_stats_ {
+    uint32_t samples;
+    uint32_t frames;
+    uint32_t overruns;    // samples dropped with the ring full
+    uint32_t send_errors; // datagrams lwIP refused
+    uint32_t bytes;       // sample bytes sent, without headers
+    uint32_t encode_us;   // time spent building datagrams
+} stream_stats;
+
+bool stream_set(const ip_addr_t *host, uint16_t port, uint32_t hz, uint32_t batch, stream_encoding encoding);
+void stream_stop(void);
+bool stream_due(void);
+void stream_push(const stream_sample *sample);
+void stream_task(__unused void *params);
+int stream_report(char *out, int len);
+
+#endif
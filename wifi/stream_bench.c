@@ -0,0 +1,173 @@
+// Host benchmark for the telemetry encodings, not part of the firmware build.
+//   cc -O2 -Iwifi wifi/stream_bench.c wifi/stream_codec.c -o stream_bench -lm
+// Runs a synthetic drive (accelerate, cruise, turn, stop) sampled at 100Hz and
+// compares bytes and encode time per sample for a text line like the TCP
+// telemetry, the raw stream_sample and the delta codec. The delta output is
+// decoded again and checked against the input, with and without lost datagrams.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stream_codec.h"
+
+#define NUM_SAMPLES 200000
+#define BATCH 4
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// a car driving a square over and over, with sensor noise
+static void make_drive(stream_sample *s, int n)
+{
+    double lc = 0, rc = 0, x = 0, y = 0, heading = 0;
+    srand(1);
+    for (int i = 0; i < n; ++i)
+    {
+        int phase = (i / 100) % 8; // one second per phase
+        int target = phase < 3 ? 120 : phase == 3 ? 60 : phase < 6 ? 120 : 0;
+        int steer = phase == 3 ? 60 : 0;
+        int ls = target + steer / 2 + rand() % 5 - 2, rs = target - steer / 2 + rand() % 5 - 2;
+        if (target == 0)
+            ls = rs = 0;
+        lc += ls / 100.0;
+        rc += rs / 100.0;
+        heading += (ls - rs) / 100.0 * 5.25 / 120 * 57.3;
+        x += (ls + rs) / 200.0 * 5.25 * __builtin_sin(heading / 57.3);
+        y += (ls + rs) / 200.0 * 5.25 * __builtin_cos(heading / 57.3);
+        int bearing = ((int)heading % 360 + 360) % 360;
+        s[i] = (stream_sample){
+            .t_us = 1000000u + i * 10000u + rand() % 40,
+            .left_count = lc,
+            .right_count = rc,
+            .left_speed = ls,
+            .right_speed = rs,
+            .left_target = target + steer / 2,
+            .right_target = target - steer / 2,
+            .left_pwm = target ? 2000 + ls * 10 : 0,
+            .right_pwm = target ? 2000 + rs * 10 : 0,
+            .bearing = bearing,
+            .bearing_error = rand() % 3 - 1,
+            .x = x * 65536,
+            .y = y * 65536,
+            .heading = heading * 65536,
+            .ultrasonic = 80 + (i / 50) % 40,
+            .mode = target ? 1 : 0,
+        };
+    }
+}
+
+static void report(const char *name, double ns, long bytes, int n)
+{
+    printf("%-22s %7.1f B/sample %7.1f ns/sample %6.1f kB/s at 100Hz\n",
+           name, (double)bytes / n, ns / n, bytes / (double)n * 100 / 1000);
+}
+
+// every sample decoded from delta frames must match, lost datagrams drop only up to the next keyframe
+static int check_roundtrip(const stream_sample *in, int n, int loss_every)
+{
+    stream_codec enc, dec;
+    stream_codec_init(&enc, 50);
+    stream_codec_init(&dec, 50);
+    uint8_t frame[BATCH * STREAM_MAX_ENCODED];
+    int bad = 0, skipped = 0, lost = 0;
+    for (int i = 0, d = 0; i < n; i += BATCH, ++d)
+    {
+        int len = 0;
+        for (int j = 0; j < BATCH; ++j)
+            len += stream_encode(&enc, &in[i + j], frame + len);
+        if (loss_every && d % loss_every == 0)
+        {
+            lost += BATCH;
+            stream_codec_reset(&dec); // the receiver sees the seq gap
+            continue;
+        }
+        const uint8_t *p = frame;
+        for (int j = 0; j < BATCH; ++j)
+        {
+            stream_sample out;
+            int used = stream_decode(&dec, p, frame + len - p, &out);
+            if (used == 0)
+                return -1;
+            p += used > 0 ? used : -used;
+            if (used < 0)
+                ++skipped;
+            else if (memcmp(&out, &in[i + j], sizeof(out)) != 0)
+                ++bad;
+        }
+    }
+    printf("roundtrip, %s: lost %d skipped %d mismatched %d\n", loss_every ? "1 in 7 datagrams lost" : "no loss", lost, skipped, bad);
+    return bad;
+}
+
+int main(void)
+{
+    stream_sample *samples = malloc(NUM_SAMPLES * sizeof(stream_sample));
+    make_drive(samples, NUM_SAMPLES);
+    static char text[128];
+    static uint8_t out[STREAM_MAX_ENCODED];
+    volatile long sink = 0;
+
+    // text, the way move_task formats its telemetry lines
+    long bytes = 0;
+    double t0 = now_ns();
+    for (int i = 0; i < NUM_SAMPLES; ++i)
+    {
+        const stream_sample *s = &samples[i];
+        bytes += snprintf(text, sizeof(text), "[ENC]lc:%ld\trc:%ld\tls:%d\trs:%d\tlt:%d\trt:%d\tcb:%d\teb:%d\tx:%ld\ty:%ld\th:%ld\tus:%u\n",
+                          (long)s->left_count, (long)s->right_count, s->left_speed, s->right_speed, s->left_target, s->right_target,
+                          s->bearing, s->bearing_error, (long)(s->x >> 16), (long)(s->y >> 16), (long)(s->heading >> 16), s->ultrasonic) + 1;
+        sink += text[5];
+    }
+    report("text line", now_ns() - t0, bytes, NUM_SAMPLES);
+
+    bytes = 0;
+    t0 = now_ns();
+    for (int i = 0; i < NUM_SAMPLES; ++i)
+    {
+        memcpy(out, &samples[i], sizeof(stream_sample));
+        bytes += sizeof(stream_sample);
+        sink += out[3];
+    }
+    report("raw stream_sample", now_ns() - t0, bytes, NUM_SAMPLES);
+
+    int intervals[] = {10, 50, 200};
+    for (int k = 0; k < 3; ++k)
+    {
+        stream_codec c;
+        stream_codec_init(&c, intervals[k]);
+        bytes = 0;
+        t0 = now_ns();
+        for (int i = 0; i < NUM_SAMPLES; ++i)
+            bytes += stream_encode(&c, &samples[i], out);
+        char name[32];
+        snprintf(name, sizeof(name), "delta, key every %d", intervals[k]);
+        report(name, now_ns() - t0, bytes, NUM_SAMPLES);
+    }
+
+    // decode speed, for the host side
+    stream_codec enc, dec;
+    stream_codec_init(&enc, 50);
+    stream_codec_init(&dec, 50);
+    uint8_t *all = malloc((long)NUM_SAMPLES * STREAM_MAX_ENCODED);
+    long len = 0;
+    for (int i = 0; i < NUM_SAMPLES; ++i)
+        len += stream_encode(&enc, &samples[i], all + len);
+    t0 = now_ns();
+    const uint8_t *p = all;
+    for (int i = 0; i < NUM_SAMPLES; ++i)
+    {
+        stream_sample s;
+        p += stream_decode(&dec, p, all + len - p, &s);
+        sink += s.mode;
+    }
+    report("delta decode", now_ns() - t0, len, NUM_SAMPLES);
+
+    int bad = check_roundtrip(samples, NUM_SAMPLES, 0) | check_roundtrip(samples, NUM_SAMPLES, 7);
+    free(all);
+    free(samples);
+    return bad != 0;
+}
@@ -0,0 +1,192 @@
+#include <stddef.h>
+#include <string.h>
+#include "stream_codec.h"
+
+typedef struct codec_field_ {
+    uint8_t offset;
+    uint8_t size;    // bytes, 1, 2 or 4
+    bool is_signed;
+    bool linear;     // predict prev + step rather than prev
+} codec_field;
+
+#define FIELD(name, sign, lin) {offsetof(stream_sample, name), sizeof(((stream_sample *)0)->name), sign, lin}
+
+static const codec_field fields[STREAM_CODEC_FIELDS] = {
+    FIELD(t_us, false, true),
+    FIELD(left_count, true, true),
+    FIELD(right_count, true, true),
+    FIELD(left_speed, true, false),
+    FIELD(right_speed, true, false),
+    FIELD(left_target, true, false),
+    FIELD(right_target, true, false),
+    FIELD(left_pwm, false, false),
+    FIELD(right_pwm, false, false),
+    FIELD(bearing, true, false),
+    FIELD(bearing_error, true, false),
+    FIELD(x, true, true),
+    FIELD(y, true, true),
+    FIELD(heading, true, false),
+    FIELD(ultrasonic, false, false),
+    FIELD(mode, false, false),
+};
+
+// the sample is packed, so go through memcpy rather than casting
+static int32_t get_field(const stream_sample *s, const codec_field *f)
+{
+    const uint8_t *p = (const uint8_t *)s + f->offset;
+    switch (f->size)
+    {
+    case 1:
+        return f->is_signed ? (int32_t)(int8_t)p[0] : p[0];
+    case 2:
+    {
+        uint16_t v;
+        memcpy(&v, p, 2);
+        return f->is_signed ? (int32_t)(int16_t)v : v;
+    }
+    default:
+    {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return (int32_t)v;
+    }
+    }
+}
+
+static void set_field(stream_sample *s, const codec_field *f, int32_t v)
+{
+    uint8_t *p = (uint8_t *)s + f->offset;
+    if (f->size == 1)
+        p[0] = v;
+    else if (f->size == 2)
+    {
+        uint16_t h = v;
+        memcpy(p, &h, 2);
+    }
+    else
+        memcpy(p, &v, 4);
+}
+
+static int put_varint(uint8_t *out, uint32_t v)
+{
+    int n = 0;
+    while (v >= 0x80)
+    {
+        out[n++] = v | 0x80;
+        v >>= 7;
+    }
+    out[n++] = v;
+    return n;
+}
+
+// 0 if the varint runs past end or is longer than 5 bytes
+static int get_varint(const uint8_t *in, const uint8_t *end, uint32_t *v)
+{
+    uint32_t r = 0;
+    for (int n = 0; n < 5 && in + n < end; ++n)
+    {
+        r |= (uint32_t)(in[n] & 0x7f) << (7 * n);
+        if (!(in[n] & 0x80))
+        {
+            *v = r;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+void stream_codec_init(stream_codec *c, uint16_t key_interval)
+{
+    memset(c, 0, sizeof(*c));
+    c->key_interval = key_interval;
+}
+
+// The next sample is a keyframe, after a gap or a change of destination
+void stream_codec_reset(stream_codec *c)
+{
+    c->have_prev = false;
+}
+
+// both ends run this after every sample so their predictions match
+static void remember(stream_codec *c, const int32_t *v, bool key)
+{
+    for (int i = 0; i < STREAM_CODEC_FIELDS; ++i)
+    {
+        // wrapping arithmetic, t_us and the counts may roll over
+        c->step[i] = c->have_prev && !key ? (int32_t)((uint32_t)v[i] - (uint32_t)c->prev[i]) : 0;
+        c->prev[i] = v[i];
+    }
+    c->have_prev = true;
+}
+
+static int32_t predict(const stream_codec *c, int i)
+{
+    return fields[i].linear ? (int32_t)((uint32_t)c->prev[i] + (uint32_t)c->step[i]) : c->prev[i];
+}
+
+// Encode one sample, out needs STREAM_MAX_ENCODED bytes. Returns the bytes written.
+int stream_encode(stream_codec *c, const stream_sample *s, uint8_t *out)
+{
+    bool key = !c->have_prev || ++c->since_key >= c->key_interval;
+    if (key)
+        c->since_key = 0;
+    int32_t v[STREAM_CODEC_FIELDS];
+    uint32_t residual[STREAM_CODEC_FIELDS];
+    uint32_t mask = key;
+    for (int i = 0; i < STREAM_CODEC_FIELDS; ++i)
+    {
+        v[i] = get_field(s, &fields[i]);
+        residual[i] = zigzag((int32_t)((uint32_t)v[i] - (uint32_t)(key ? 0 : predict(c, i))));
+        if (residual[i])
+            mask |= 2u << i;
+    }
+    int n = put_varint(out, mask);
+    for (int i = 0; i < STREAM_CODEC_FIELDS; ++i)
+        if (residual[i])
+            n += put_varint(out + n, residual[i]);
+    remember(c, v, key);
+    return n;
+}
+
+// Decode one sample. Returns the bytes used, 0 if the input is malformed, or
+// minus the bytes used for a delta with no reference (the datagram before it
+// was lost), that sample is skipped until the next keyframe.
+int stream_decode(stream_codec *c, const uint8_t *in, int len, stream_sample *s)
+{
+    const uint8_t *p = in, *end = in + len;
+    uint32_t mask;
+    int n = get_varint(p, end, &mask);
+    if (n == 0 || mask >> (STREAM_CODEC_FIELDS + 1))
+        return 0;
+    p += n;
+    bool key = mask & 1;
+    int32_t v[STREAM_CODEC_FIELDS];
+    for (int i = 0; i < STREAM_CODEC_FIELDS; ++i)
+    {
+        uint32_t r = 0;
+        if (mask & (2u << i))
+        {
+            if ((n = get_varint(p, end, &r)) == 0)
+                return 0;
+            p += n;
+        }
+        v[i] = (int32_t)((uint32_t)(key || !c->have_prev ? 0 : predict(c, i)) + (uint32_t)unzigzag(r));
+    }
+    if (!key && !c->have_prev)
+        return -(int)(p - in);
+    memset(s, 0, sizeof(*s));
+    for (int i = 0; i < STREAM_CODEC_FIELDS; ++i)
+        set_field(s, &fields[i], v[i]);
+    remember(c, v, key);
+    return p - in;
+}
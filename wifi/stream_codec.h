@@ -0,0 +1,33 @@
+#ifndef stream_codec_h
+#define stream_codec_h
+#include <stdint.h>
+#include <stdbool.h>
+#include "stream_frame.h"
+
+// Delta encoding for stream_sample, used by STREAM_VERSION_DELTA datagrams.
+// Each sample is a varint mask followed by one zigzag varint per set bit:
+//   mask bit 0      keyframe, the values are against zero rather than a prediction
+//   mask bit 1 + n  field n differs from its prediction, the varint is the residual
+// The prediction is the previous sample, or for time, counts and position the
+// previous sample plus the last step. Most fields don't change between samples
+// at 100Hz, an idle car encodes to three bytes a sample.
+// Both ends keep the same state. A receiver that loses a datagram waits for the
+// next keyframe, the sender makes one every key_interval samples and after a gap.
+
+#define STREAM_CODEC_FIELDS 16
+#define STREAM_MAX_ENCODED (3 + STREAM_CODEC_FIELDS * 5) // mask plus a 5 byte varint per field
+
+typedef struct stream_codec_ {
+    int32_t prev[STREAM_CODEC_FIELDS];
+    int32_t step[STREAM_CODEC_FIELDS]; // prev minus the one before it
+    bool have_prev;
+    uint16_t key_interval;
+    uint16_t since_key;
+} stream_codec;
+
+void stream_codec_init(stream_codec *c, uint16_t key_interval);
+void stream_codec_reset(stream_codec *c);
+int stream_encode(stream_codec *c, const stream_sample *s, uint8_t *out);
+int stream_decode(stream_codec *c, const uint8_t *in, int len, stream_sample *s);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef stream_frame_h
+#define stream_frame_h
+#include <stdint.h>
+
+// UDP telemetry wire format, shared by the firmware and the host receiver.
+// Datagram, little endian:
+//   uint16 magic STREAM_MAGIC, uint8 version, uint8 count, uint32 seq of the first sample,
+//   count samples, the ones that follow carry seq + 1, seq + 2...
+// Version STREAM_VERSION sends each sample as a stream_sample, STREAM_VERSION_DELTA
+// sends them through stream_codec.h.
+
+#define STREAM_MAGIC 0x5354 // "TS"
+#define STREAM_VERSION 1
+#define STREAM_VERSION_DELTA 2
+#define STREAM_MAX_BATCH 16 // samples per datagram, keeps it under one MTU
+
+typedef struct __attribute__((packed)) stream_header_ {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t count;
+    uint32_t seq;
+} stream_header;
+
+typedef struct __attribute__((packed)) stream_sample_ {
+    uint32_t t_us;
+    int32_t left_count, right_count;   // encoder edges
+    int16_t left_speed, right_speed;   // edges/s, measured
+    int16_t left_target, right_target; // edges/s
+    uint16_t left_pwm, right_pwm;
+    int16_t bearing;                   // degrees
+    int16_t bearing_error;
+    int32_t x, y;                      // Q16.16 mm, see odometry.h
+    int32_t heading;                   // Q16.16 degrees
+    uint16_t ultrasonic;               // cm
+    uint8_t mode;
+    uint8_t reserved;
+} stream_sample;
+
+#endif
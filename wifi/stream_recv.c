@@ -0,0 +1,188 @@
+// Host receiver for the UDP telemetry stream, not part of the firmware build.
+//   cc -O2 -Iwifi wifi/stream_recv.c wifi/stream_codec.c -o stream_recv
+//   ./stream_recv [port] [--csv]
+// then send "stream <port>,<hz>" to the car over the command channel.
+// Counts lost, reordered and duplicate samples from the sequence numbers and
+// prints a summary every second, or every sample as CSV with --csv.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "stream_frame.h"
+#include "stream_codec.h"
+
+typedef struct recv_stats_ {
+    uint64_t samples;
+    uint64_t frames;
+    uint64_t lost;      // seqs skipped, taken back if they turn up late
+    uint64_t reordered; // arrived after a later seq
+    uint64_t duplicate;
+    uint64_t bad;       // wrong magic, version or length
+    uint64_t skipped;   // delta samples after a loss, before the next keyframe
+} recv_stats;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// highest seq seen so far plus a window of the ones just below it, to tell late from duplicate
+#define WINDOW 256
+static bool started = false;
+static uint32_t top;
+static bool seen[WINDOW];
+
+static void count_seq(recv_stats *st, uint32_t seq)
+{
+    if (!started || (int32_t)(seq - top) > WINDOW * 64 || (int32_t)(top - seq) > WINDOW * 64)
+    {
+        // first sample, or the car restarted
+        started = true;
+        top = seq;
+        memset(seen, 0, sizeof(seen));
+        seen[seq % WINDOW] = true;
+        return;
+    }
+    int32_t ahead = seq - top;
+    if (ahead > 0)
+    {
+        for (uint32_t s = top + 1; s != seq; ++s)
+            seen[s % WINDOW] = false;
+        seen[seq % WINDOW] = true;
+        st->lost += ahead - 1;
+        top = seq;
+    }
+    else if (-ahead >= WINDOW)
+    {
+        ++st->reordered; // too old to tell, call it late
+    }
+    else if (seen[seq % WINDOW])
+    {
+        ++st->duplicate;
+    }
+    else
+    {
+        seen[seq % WINDOW] = true;
+        ++st->reordered;
+        --st->lost;
+    }
+}
+
+static void print_csv(uint32_t seq, const stream_sample *s)
+{
+    printf("%u,%u,%d,%d,%d,%d,%d,%d,%u,%u,%d,%d,%.1f,%.1f,%.1f,%u,%u\n",
+           seq, s->t_us, s->left_count, s->right_count, s->left_speed, s->right_speed,
+           s->left_target, s->right_target, s->left_pwm, s->right_pwm, s->bearing, s->bearing_error,
+           s->x / 65536.0, s->y / 65536.0, s->heading / 65536.0, s->ultrasonic, s->mode);
+}
+
+int main(int argc, char **argv)
+{
+    int port = 4244;
+    bool csv = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--csv") == 0)
+            csv = true;
+        else
+            port = atoi(argv[i]);
+    }
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY)};
+    if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("bind");
+        return 1;
+    }
+    fprintf(stderr, "listening on udp port %d\n", port);
+    if (csv)
+    {
+        setvbuf(stdout, NULL, _IOLBF, 0); // rows show up as they arrive when piped
+        printf("seq,t_us,lc,rc,ls,rs,lt,rt,lpwm,rpwm,bearing,berr,x,y,heading,us,mode\n");
+    }
+
+    stream_codec codec;
+    stream_codec_init(&codec, 0);
+    uint32_t next_seq = 0;
+    recv_stats st = {0}, last = {0};
+    double last_print = now_s();
+    uint8_t buf[2048];
+    while (1)
+    {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n < 0)
+        {
+            perror("recv");
+            return 1;
+        }
+        stream_header hdr;
+        if (n < (ssize_t)sizeof(hdr))
+        {
+            ++st.bad;
+            continue;
+        }
+        memcpy(&hdr, buf, sizeof(hdr));
+        bool raw = hdr.version == STREAM_VERSION;
+        if (hdr.magic != STREAM_MAGIC || (!raw && hdr.version != STREAM_VERSION_DELTA) ||
+            (raw && n != (ssize_t)(sizeof(hdr) + hdr.count * sizeof(stream_sample))))
+        {
+            ++st.bad;
+            continue;
+        }
+        ++st.frames;
+        // a delta can only be decoded against the sample just before it
+        if (hdr.seq != next_seq)
+            stream_codec_reset(&codec);
+        next_seq = hdr.seq + hdr.count;
+        const uint8_t *p = buf + sizeof(hdr), *end = buf + n;
+        for (int i = 0; i < hdr.count; ++i)
+        {
+            stream_sample s;
+            if (raw)
+            {
+                memcpy(&s, p, sizeof(s));
+                p += sizeof(s);
+            }
+            else
+            {
+                int used = stream_decode(&codec, p, end - p, &s);
+                if (used == 0)
+                {
+                    ++st.bad;
+                    stream_codec_reset(&codec);
+                    break;
+                }
+                p += used > 0 ? used : -used;
+                if (used < 0)
+                {
+                    ++st.skipped;
+                    count_seq(&st, hdr.seq + i);
+                    ++st.samples;
+                    continue;
+                }
+            }
+            ++st.samples;
+            count_seq(&st, hdr.seq + i);
+            if (csv)
+                print_csv(hdr.seq + i, &s);
+        }
+
+        double t = now_s();
+        if (t - last_print >= 1.0)
+        {
+            uint64_t expected = (st.samples - st.duplicate) + st.lost;
+            fprintf(stderr, "%.0f samples/s %.0f frames/s  lost %llu (%.2f%%) late %llu dup %llu bad %llu skipped %llu\n",
+                    (st.samples - last.samples) / (t - last_print), (st.frames - last.frames) / (t - last_print),
+                    (unsigned long long)st.lost, expected ? 100.0 * st.lost / expected : 0.0,
+                    (unsigned long long)st.reordered, (unsigned long long)st.duplicate, (unsigned long long)st.bad,
+                    (unsigned long long)st.skipped);
+            last = st;
+            last_print = t;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include "pico/cyw43_arch.h"
+#include "lwip/udp.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "teleop.h"
+
+static struct udp_pcb *teleop_pcb = NULL;
+static void (*setpoint_callback)(void) = NULL;
+
+// written from the lwIP callback, read by move_task under a critical section
+static teleop_setpoint latest;
+static bool have_setpoint = false;
+static bool timed_out = true;
+static teleop_stats stats;
+
+static bool fresh(uint32_t now)
+{
+    return have_setpoint && now - latest.received_us < TELEOP_TIMEOUT_MS * 1000;
+}
+
+// lwIP callback, IRQ context with the threadsafe_background arch
+static void teleop_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+    uint8_t raw[8];
+    if (p->tot_len != sizeof(raw) || pbuf_copy_partial(p, raw, sizeof(raw), 0) != sizeof(raw))
+    {
+        ++stats.malformed;
+        pbuf_free(p);
+        return;
+    }
+    pbuf_free(p);
+
+    teleop_setpoint sp = {
+        .seq = raw[0] | raw[1] << 8 | raw[2] << 16 | (uint32_t)raw[3] << 24,
+        .linear = (int16_t)(raw[4] | raw[5] << 8),
+        .angular = (int16_t)(raw[6] | raw[7] << 8),
+        .received_us = time_us_32(),
+    };
+    bool accepted;
+    UBaseType_t irq = taskENTER_CRITICAL_FROM_ISR();
+    ++stats.packets;
+    // after a timeout any seq is taken, so a restarted host isn't locked out
+    accepted = !fresh(sp.received_us) || (int32_t)(sp.seq - latest.seq) > 0;
+    if (accepted)
+    {
+        latest = sp;
+        have_setpoint = true;
+    }
+    else
+    {
+        ++stats.stale;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(irq);
+
+    if (accepted && setpoint_callback)
+        setpoint_callback();
+}
+
+// Listen for setpoints, on_setpoint is called from the lwIP callback for each new one
+bool teleop_start(void (*on_setpoint)(void))
+{
+    setpoint_callback = on_setpoint;
+    cyw43_arch_lwip_begin();
+    teleop_pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+    err_t err = teleop_pcb ? udp_bind(teleop_pcb, IP_ANY_TYPE, TELEOP_PORT) : ERR_MEM;
+    if (err == ERR_OK)
+        udp_recv(teleop_pcb, teleop_recv, NULL);
+    cyw43_arch_lwip_end();
+    if (err != ERR_OK)
+    {
+        printf("Failed to bind teleop to port %u\n", TELEOP_PORT);
+        return false;
+    }
+    printf("Teleop listening on udp port %u\n", TELEOP_PORT);
+    return true;
+}
+
+// Forget the held setpoint, so entering teleop never acts on an old one
+void teleop_reset(void)
+{
+    taskENTER_CRITICAL();
+    have_setpoint = false;
+    timed_out = true;
+    taskEXIT_CRITICAL();
+}
+
+// Newest setpoint, false if there is none within TELEOP_TIMEOUT_MS
+bool teleop_latest(teleop_setpoint *sp)
+{
+    taskENTER_CRITICAL();
+    bool ok = fresh(time_us_32());
+    *sp = latest;
+    taskEXIT_CRITICAL();
+    if (!ok && !timed_out)
+        ++stats.timeouts;
+    timed_out = !ok;
+    return ok;
+}
+
+int teleop_report(char *out, int len)
+{
+    return snprintf(out, len, "[TEL]port:%u\tpkts:%lu\tstale:%lu\tbad:%lu\ttimeouts:%lu\tseq:%lu\n",
+                    TELEOP_PORT, stats.packets, stats.stale, stats.malformed, stats.timeouts, latest.seq);
+}
@@ -0,0 +1,32 @@
+#ifndef teleop_h
+#define teleop_h
+#include "pico/stdlib.h"
+
+// Streaming velocity setpoints over UDP. The host sends one 8 byte datagram
+// per setpoint (50-100Hz), little endian:
+//   uint32 seq, int16 linear (edges/s, + forward), int16 angular (edges/s, left minus right wheel)
+// Only the newest setpoint is kept, older or reordered datagrams are dropped.
+
+#define TELEOP_PORT 4243
+#define TELEOP_TIMEOUT_MS 200 // no setpoint for this long and the car stops
+
+typedef struct teleop_setpoint_ {
+    uint32_t seq;
+    int16_t linear;
+    int16_t angular;
+    uint32_t received_us;
+} teleop_setpoint;
+
+typedef struct teleop_stats_ {
+    uint32_t packets;
+    uint32_t stale;     // older seq than the one held
+    uint32_t malformed;
+    uint32_t timeouts;
+} teleop_stats;
+
+bool teleop_start(void (*on_setpoint)(void));
+void teleop_reset(void);
+bool teleop_latest(teleop_setpoint *sp);
+int teleop_report(char *out, int len);
+
+#endif